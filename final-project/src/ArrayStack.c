@@ -20,16 +20,18 @@ ArrayStack* ArrayStack_Create(unsigned int capacity, size_t elementSize) {
     stack->capacity = capacity;
     stack->start = stack->size = 0;
     stack->array = malloc(elementSize * capacity);
-    if (!stack->array) ArrayStack_Destroy(stack);
+    if (!stack->array) return ArrayStack_Destroy(stack);
     return stack;
 }
 
 ArrayStack* ArrayStack_Copy(const ArrayStack *stack) {
+    if (!stack) return NULL;
     ArrayStack *copy = malloc(sizeof(ArrayStack));
+    if (!copy) return NULL;
     memcpy(copy, stack, sizeof(ArrayStack));
     copy->array = malloc(copy->elementSize * copy->capacity);
-    if (!copy->array) ArrayStack_Destroy(copy);
-    memcpy(copy->array, stack->array, copy->capacity);
+    if (!copy->array) return ArrayStack_Destroy(copy);
+    memcpy(copy->array, stack->array, copy->elementSize * copy->capacity);
     return copy;
 }
 
@@ -83,3 +85,15 @@ void* ArrayStack_PopLeft(ArrayStack *stack) {
     stack->start = (stack->start + 1) % stack->capacity;
     return startElement;
 }
+
+void* ArrayStack_Get(const ArrayStack *stack, unsigned int index) {
+    if (!stack || index >= stack->size) return NULL;
+    unsigned int offset = (stack->start + index) % stack->capacity;
+    return stack->array + offset * stack->elementSize;
+}
+
+void ArrayStack_Clear(ArrayStack *stack) {
+    if (!stack) return;
+    stack->size = 0;
+    stack->start = 0;
+}
@@ -89,5 +89,23 @@ void* ArrayStack_Pop(ArrayStack* stack);
  */
 void* ArrayStack_PopLeft(ArrayStack* stack);
 
+/**
+ * Peek at the element at a given index of the given ArrayStack instance,
+ * counting from the bottom-most element (index 0).
+ * No transfer of ownership - returned pointer should be memcpy().
+ * @param   stack       ArrayStack instance
+ * @param   index       the index of the element to peek at
+ * @return  NULL if stack == NULL or index is out of range
+ *          the element at index otherwise
+ */
+void* ArrayStack_Get(const ArrayStack* stack, unsigned int index);
+
+/**
+ * Remove all the elements of the given ArrayStack instance.
+ * Does nothing if stack == NULL.
+ * @param   stack       ArrayStack instance
+ */
+void ArrayStack_Clear(ArrayStack* stack);
+
 
 #endif
@@ -0,0 +1,301 @@
+#define _POSIX_C_SOURCE 200809L // mmap(), sysconf()
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "BatchEngine.h"
+#include "ChessEval.h"
+
+#define BATCH_LINE_SIZE         256 // longer lines are cut
+#define BATCH_RESULT_SIZE       96
+#define BATCH_WINDOW            1024 // lines read ahead of the last one written
+#define BATCH_MAX_THREADS       64
+#define BATCH_DEFAULT_DEPTH     4
+
+#define MSG_RESULT              "bestmove %c%c%c%c score cp %d depth %d nodes %lu"
+#define MSG_NO_MOVES            "bestmove (none) score cp %d depth 0 nodes 0"
+#define MSG_INVALID_FEN         "error invalid fen"
+#define MSG_ALLOC_FAILED        "error out of memory"
+#define MSG_FILE_FAILED         "ERROR: FEN file %s cannot be read\n"
+#define MSG_THREADS_FAILED      "ERROR: worker threads cannot be started\n"
+#define MSG_DEPTH_INVALID       "ERROR: depth %s should be between 1 to %d\n"
+
+
+typedef enum BatchSlotState {
+    BATCH_SLOT_EMPTY,
+    BATCH_SLOT_PENDING, // read, waiting for or being analysed by a worker
+    BATCH_SLOT_DONE, // analysed, waiting to be written
+} BatchSlotState;
+
+typedef struct BatchSlot {
+    BatchSlotState state;
+    char fen[BATCH_LINE_SIZE];
+    char result[BATCH_RESULT_SIZE];
+} BatchSlot;
+
+struct BatchEngine {
+    const char *path; // NULL for stdin
+    const char *depthOption; // as given, for the error message
+    int depth; // 0 if the given depth is invalid
+    unsigned long maxNodes; // 0 for no limit
+    int threads;
+    // shared by the reader, the workers & the writer, line i in slots[i % BATCH_WINDOW]
+    BatchSlot slots[BATCH_WINDOW];
+    unsigned long readLines; // guarded by lock, as are all of the below
+    unsigned long takenLines;
+    unsigned long writtenLines;
+    bool isEnded; // all of the input was read
+    pthread_mutex_t lock;
+    pthread_cond_t hasWork;
+    pthread_cond_t hasResult;
+    pthread_cond_t hasSpace;
+};
+
+/**
+ * Find the value of a given option in the command-line arguments.
+ * @param   argc        number of command-line arguments
+ * @param   argv        the command-line arguments
+ * @param   option      the option to look for, e.g. "--depth"
+ * @return  NULL if the option wasn't given, or has no value
+ *          the argument following the option otherwise
+ */
+const char* getBatchOption(int argc, const char *argv[], const char *option) {
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], option) == 0) return argv[i + 1];
+    }
+    return NULL;
+}
+
+BatchEngine* BatchEngine_Create(int argc, const char *argv[]) {
+    BatchEngine *engine = malloc(sizeof(BatchEngine));
+    if (!engine) return NULL;
+    const char *path = getBatchOption(argc, argv, "--batch");
+    const char *depth = getBatchOption(argc, argv, "--depth");
+    const char *nodes = getBatchOption(argc, argv, "--nodes");
+    const char *threads = getBatchOption(argc, argv, "--threads");
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    engine->path = path && path[0] != '-' ? path : NULL;
+    engine->maxNodes = nodes ? strtoul(nodes, NULL, 10) : 0;
+    // unbounded only with a node limit, a search to GAME_SEARCH_MAX_DEPTH never ends
+    engine->depthOption = depth;
+    engine->depth = engine->maxNodes ? GAME_SEARCH_MAX_DEPTH : BATCH_DEFAULT_DEPTH;
+    if (depth) {
+        char *end;
+        long value = strtol(depth, &end, 10);
+        bool isValid = end != depth && *end == '\0' && value >= 1 && value <= GAME_SEARCH_MAX_DEPTH;
+        engine->depth = isValid ? (int)value : 0;
+    }
+    engine->threads = threads ? atoi(threads) : cores > 0 ? (int)cores : 1;
+    if (engine->threads < 1) engine->threads = 1;
+    if (engine->threads > BATCH_MAX_THREADS) engine->threads = BATCH_MAX_THREADS;
+    for (int i = 0; i < BATCH_WINDOW; i++) engine->slots[i].state = BATCH_SLOT_EMPTY;
+    engine->readLines = engine->takenLines = engine->writtenLines = 0;
+    engine->isEnded = false;
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->hasWork, NULL);
+    pthread_cond_init(&engine->hasResult, NULL);
+    pthread_cond_init(&engine->hasSpace, NULL);
+    return engine;
+}
+
+BatchEngine* BatchEngine_Destroy(BatchEngine *engine) {
+    if (!engine) return NULL;
+    pthread_mutex_destroy(&engine->lock);
+    pthread_cond_destroy(&engine->hasWork);
+    pthread_cond_destroy(&engine->hasResult);
+    pthread_cond_destroy(&engine->hasSpace);
+    free(engine);
+    return NULL;
+}
+
+/**
+ * Analyse a FEN record, and format the result line.
+ * @param   engine      the instance to use
+ * @param   game        the worker's game, NULL if it couldn't be created
+ * @param   fen         the record
+ * @param   result      output parameter for the line, BATCH_RESULT_SIZE long
+ */
+void analyseBatchLine(const BatchEngine *engine, ChessGame *game, const char *fen, char *result) {
+    if (!game) {
+        snprintf(result, BATCH_RESULT_SIZE, MSG_ALLOC_FAILED);
+        return;
+    }
+    if (ChessGame_FromFEN(game, fen) != CHESS_SUCCESS) {
+        snprintf(result, BATCH_RESULT_SIZE, MSG_INVALID_FEN);
+        return;
+    }
+    GameSearchHooks hooks = { .isStopped = NULL, .onDepth = NULL, .maxNodes = engine->maxNodes };
+    GameSearchInfo info;
+    if (GameManager_Search(game, engine->depth, &hooks, &info)) {
+        ChessMove move = info.bestMove;
+        snprintf(result, BATCH_RESULT_SIZE, MSG_RESULT,
+                 'a' + move.from.x, '1' + move.from.y, 'a' + move.to.x, '1' + move.to.y,
+                 info.score, info.depth, info.stats.nodes);
+        return;
+    }
+    ChessStatus status;
+    ChessGame_GetGameStatus(game, &status);
+    snprintf(result, BATCH_RESULT_SIZE, MSG_NO_MOVES,
+             status == CHESS_STATUS_CHECKMATE ? -CHESS_EVAL_CHECKMATE_SCORE : 0);
+}
+
+/**
+ * Analyse the lines read, one at a time, until the input ends.
+ * @param   argument    the BatchEngine
+ * @return  NULL
+ */
+void* runBatchWorker(void *argument) {
+    BatchEngine *engine = argument;
+    ChessGame *game = ChessGame_Create();
+    pthread_mutex_lock(&engine->lock);
+    while (true) {
+        while (engine->takenLines == engine->readLines && !engine->isEnded) {
+            pthread_cond_wait(&engine->hasWork, &engine->lock);
+        }
+        if (engine->takenLines == engine->readLines) break;
+        BatchSlot *slot = &engine->slots[engine->takenLines++ % BATCH_WINDOW];
+        pthread_mutex_unlock(&engine->lock);
+        analyseBatchLine(engine, game, slot->fen, slot->result);
+        pthread_mutex_lock(&engine->lock);
+        slot->state = BATCH_SLOT_DONE;
+        pthread_cond_signal(&engine->hasResult);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    if (game) ChessGame_Destroy(game);
+    return NULL;
+}
+
+/**
+ * Write the result lines in input order, as soon as each one and all of
+ * the lines before it are analysed, until the input ends.
+ * @param   argument    the BatchEngine
+ * @return  NULL
+ */
+void* runBatchWriter(void *argument) {
+    BatchEngine *engine = argument;
+    pthread_mutex_lock(&engine->lock);
+    while (true) {
+        BatchSlot *slot = &engine->slots[engine->writtenLines % BATCH_WINDOW];
+        if (slot->state != BATCH_SLOT_DONE) {
+            if (engine->isEnded && engine->writtenLines == engine->readLines) break;
+            pthread_mutex_unlock(&engine->lock);
+            fflush(stdout); // only while waiting, so results are written in blocks
+            pthread_mutex_lock(&engine->lock);
+            while (slot->state != BATCH_SLOT_DONE &&
+                   !(engine->isEnded && engine->writtenLines == engine->readLines)) {
+                pthread_cond_wait(&engine->hasResult, &engine->lock);
+            }
+            continue;
+        }
+        pthread_mutex_unlock(&engine->lock);
+        puts(slot->result); // the slot isn't reused before it's emptied
+        pthread_mutex_lock(&engine->lock);
+        slot->state = BATCH_SLOT_EMPTY;
+        engine->writtenLines++;
+        pthread_cond_signal(&engine->hasSpace);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    fflush(stdout);
+    return NULL;
+}
+
+/**
+ * Hand a line of the input to the workers, once its slot is free.
+ * @param   engine      the instance to use
+ * @param   line        the line, not null terminated
+ * @param   length      the line's length, without its end of line
+ */
+void addBatchLine(BatchEngine *engine, const char *line, size_t length) {
+    if (length >= BATCH_LINE_SIZE) length = BATCH_LINE_SIZE - 1;
+    pthread_mutex_lock(&engine->lock);
+    BatchSlot *slot = &engine->slots[engine->readLines % BATCH_WINDOW];
+    while (slot->state != BATCH_SLOT_EMPTY) pthread_cond_wait(&engine->hasSpace, &engine->lock);
+    memcpy(slot->fen, line, length);
+    slot->fen[length] = '\0';
+    slot->state = BATCH_SLOT_PENDING;
+    engine->readLines++;
+    pthread_cond_signal(&engine->hasWork);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+/**
+ * Hand all lines of the memory-mapped input file to the workers.
+ * @param   engine      the instance to use
+ * @return  true        if the file was read
+ *          false       if it can't be opened or mapped
+ */
+bool readBatchFile(BatchEngine *engine) {
+    int fd = open(engine->path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = status.st_size;
+    const char *mapping = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd); // the mapping stays valid
+    if (mapping == MAP_FAILED) return false;
+    if (mapping) posix_madvise((void *)mapping, size, POSIX_MADV_SEQUENTIAL);
+    for (const char *line = mapping, *end = mapping + size; line < end;) {
+        const char *next = memchr(line, '\n', end - line);
+        size_t length = (next ? next : end) - line;
+        if (length && line[length - 1] == '\r') length--;
+        addBatchLine(engine, line, length);
+        line = next ? next + 1 : end;
+    }
+    if (mapping) munmap((void *)mapping, size);
+    return true;
+}
+
+/**
+ * Hand all lines of stdin to the workers.
+ * @param   engine      the instance to use
+ */
+void readBatchStdin(BatchEngine *engine) {
+    char line[BATCH_LINE_SIZE];
+    while (fgets(line, sizeof(line), stdin)) {
+        size_t length = strcspn(line, "\r\n");
+        if (!line[length]) { // cut, skip the rest of the line
+            int c;
+            while ((c = getchar()) != EOF && c != '\n');
+        }
+        addBatchLine(engine, line, length);
+    }
+}
+
+GameCommand BatchEngine_ProcessInput(BatchEngine *engine) {
+    GameCommand command = { .type = GAME_COMMAND_QUIT };
+    if (!engine) return command;
+    if (!engine->depth) {
+        fprintf(stderr, MSG_DEPTH_INVALID, engine->depthOption, GAME_SEARCH_MAX_DEPTH);
+        return command;
+    }
+    pthread_t workers[BATCH_MAX_THREADS], writer;
+    int workersCount = 0;
+    while (workersCount < engine->threads &&
+           pthread_create(&workers[workersCount], NULL, runBatchWorker, engine) == 0) {
+        workersCount++;
+    }
+    bool isWriting = workersCount && pthread_create(&writer, NULL, runBatchWriter, engine) == 0;
+    if (!isWriting) {
+        fprintf(stderr, MSG_THREADS_FAILED);
+    } else if (!engine->path) {
+        readBatchStdin(engine);
+    } else if (!readBatchFile(engine)) {
+        fprintf(stderr, MSG_FILE_FAILED, engine->path);
+    }
+    pthread_mutex_lock(&engine->lock);
+    engine->isEnded = true;
+    pthread_cond_broadcast(&engine->hasWork);
+    pthread_cond_broadcast(&engine->hasResult);
+    pthread_mutex_unlock(&engine->lock);
+    for (int i = 0; i < workersCount; i++) pthread_join(workers[i], NULL);
+    if (isWriting) pthread_join(writer, NULL);
+    return command;
+}
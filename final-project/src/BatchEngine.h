@@ -0,0 +1,40 @@
+#ifndef BATCH_ENGINE_H_
+#define BATCH_ENGINE_H_
+
+#include "GameManager.h"
+
+
+typedef struct BatchEngine BatchEngine;
+
+/**
+ * Create new BatchEngine instance, with the options of the command-line
+ * arguments: "--batch [file]" - the FEN file to read instead of stdin,
+ * "--depth <plies>", "--nodes <count>" and "--threads <count>".
+ * The depth defaults to 4, or to GAME_SEARCH_MAX_DEPTH with a node limit;
+ * an invalid depth is reported by BatchEngine_ProcessInput, which won't search.
+ * @param   argc        number of command-line arguments
+ * @param   argv        the command-line arguments
+ * @return  NULL if malloc failed
+ *          BatchEngine* instance otherwise
+ */
+BatchEngine* BatchEngine_Create(int argc, const char *argv[]);
+
+/**
+ * Free all resources for a given BatchEngine instance.
+ * @param   engine      the instance to destroy
+ * @return  NULL
+ */
+BatchEngine* BatchEngine_Destroy(BatchEngine *engine);
+
+/**
+ * Analyse every FEN record of the input, one per line, on a pool of worker
+ * threads, and write a result line for each input line to stdout - in input
+ * order, through a fixed window of lines, so any number of lines can be read.
+ * The input file is memory-mapped, stdin is read line by line.
+ * @param   engine      the instance to use
+ * @return  command     a GAME_COMMAND_QUIT
+ */
+GameCommand BatchEngine_ProcessInput(BatchEngine *engine);
+
+
+#endif
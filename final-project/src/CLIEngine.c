@@ -1,6 +1,13 @@
+#define _POSIX_C_SOURCE 200809L // sem_init(), pthread_cancel(), clock_gettime()
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "CLIEngine.h"
 
 #define MSG_APP_INIT            " Chess\n-------\n"
@@ -20,43 +27,176 @@
 #define MSG_MOVE_CAPTURES       "<%d,%c>^\n"
 #define MSG_MOVE_BOTH           "<%d,%c>*^\n"
 #define MSG_GAME_SAVED          "Game saved to: %s\n"
+#define MSG_GAME_EXPORTED       "Game exported to: %s\n"
 #define MSG_UNDO_MOVE           "Undo move for %s player: <%d,%c> -> <%d,%c>\n"
 #define MSG_RESTART             "Restarting...\n"
 #define MSG_AI_MOVE             "Computer: move %s at <%d,%c> to <%d,%c>\n"
 
 #define INPUT_DELIMITERS        " \t\r\n"
+#define INPUT_QUEUE_SIZE        64 // lines read ahead, a power of 2
+#define JSON_RESPONSE_SIZE      8192 // longer responses are cut
 #define MAX_INT_VALUE           50
 
 
+typedef struct InputLine {
+    char text[GAME_COMMAND_MAX_LINE_LENGTH];
+    bool isEnd; // stdin ended, text is empty
+} InputLine;
+
 struct CLIEngine {
     char input[GAME_COMMAND_MAX_LINE_LENGTH];
+    // a single-producer single-consumer queue: the reader thread pushes at tail,
+    // the main thread pops at head, each index only written by its own thread
+    InputLine lines[INPUT_QUEUE_SIZE];
+    unsigned long head;
+    unsigned long tail;
+    sem_t hasLines; // only to sleep on, the queue itself is lock-free
+    sem_t hasSpace;
+    pthread_t reader;
+    bool isReading; // the reader thread was started
+    bool isEnded; // the end of stdin was popped
+    GameSearchHooks hooks;
+    // JSON-lines mode, a response per command
+    bool isJson;
+    bool isTimed; // false to answer "ms":0
+    bool isAnswering; // a command was read and not answered yet
+    long long commandTime; // when it was read
+    GameCommand pendingCommand; // answered with the AI's reply, if isPending
+    bool isPending;
 };
 
-CLIEngine* CLIEngine_Create() {
+/**
+ * Retrieve the time on a monotonic clock.
+ * @return  the time in microseconds
+ */
+long long getInputTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (long long)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+/**
+ * Read stdin line by line into a given CLIEngine's queue, until it ends.
+ * @param   argument    the CLIEngine
+ * @return  NULL
+ */
+void* runInputReader(void *argument) {
+    CLIEngine *engine = argument;
+    bool isEnd = false;
+    while (!isEnd) {
+        sem_wait(&engine->hasSpace);
+        unsigned long tail = __atomic_load_n(&engine->tail, __ATOMIC_RELAXED);
+        InputLine *line = &engine->lines[tail % INPUT_QUEUE_SIZE];
+        isEnd = line->isEnd = !fgets(line->text, GAME_COMMAND_MAX_LINE_LENGTH, stdin);
+        if (isEnd) line->text[0] = '\0';
+        __atomic_store_n(&engine->tail, tail + 1, __ATOMIC_RELEASE);
+        sem_post(&engine->hasLines);
+    }
+    return NULL;
+}
+
+/**
+ * Check whether a given input line is a given argument-less command.
+ * @param   text        the line
+ * @param   name        the command, e.g. "quit"
+ * @return  true        if the line's only token is name
+ *          false       otherwise
+ */
+bool isInputCommand(const char *text, const char *name) {
+    text += strspn(text, INPUT_DELIMITERS);
+    size_t length = strlen(name);
+    return strncmp(text, name, length) == 0 && !text[length + strspn(text + length, INPUT_DELIMITERS)];
+}
+
+/**
+ * Check whether the next command waiting in a given CLIEngine's queue is
+ * a quit or a stop command, without popping any line - the
+ * GameSearchHooks.isStopped() of the AI's searches, called from the main thread.
+ * Commands further down a piped stream are left to stop later searches.
+ * @param   context     the CLIEngine
+ * @return  true        if the next non-empty line read is "quit" or "stop"
+ *          false       otherwise
+ */
+bool isInputStopping(void *context) {
+    CLIEngine *engine = context;
+    unsigned long tail = __atomic_load_n(&engine->tail, __ATOMIC_ACQUIRE);
+    for (unsigned long i = engine->head; i != tail; i++) {
+        const char *text = engine->lines[i % INPUT_QUEUE_SIZE].text;
+        if (text[0] == '\n') continue;
+        return isInputCommand(text, "quit") || isInputCommand(text, "stop");
+    }
+    return false;
+}
+
+CLIEngine* CLIEngine_Create(bool isJson, bool isTimed) {
     CLIEngine *engine = malloc(sizeof(CLIEngine));
     if (!engine) return CLIEngine_Destroy(engine);
+    engine->head = engine->tail = 0;
+    engine->isEnded = false;
+    engine->isJson = isJson;
+    engine->isTimed = isTimed;
+    engine->isAnswering = engine->isPending = false;
+    engine->hooks = (GameSearchHooks){ .isStopped = isInputStopping, .onDepth = NULL,
+                                       .context = engine, .maxNodes = 0 };
+    sem_init(&engine->hasLines, 0, 0);
+    sem_init(&engine->hasSpace, 0, INPUT_QUEUE_SIZE);
+    engine->isReading = pthread_create(&engine->reader, NULL, runInputReader, engine) == 0;
+    if (isJson) return engine; // only responses are written
     printf(MSG_APP_INIT);
     printf(MSG_SETTINGS_STATE);
     return engine;
 }
 
 CLIEngine* CLIEngine_Destroy(CLIEngine *engine) {
-    if (!engine) NULL;
+    if (!engine) return NULL;
+    if (engine->isReading) { // it may be blocked on stdin
+        pthread_cancel(engine->reader);
+        pthread_join(engine->reader, NULL);
+    }
+    sem_destroy(&engine->hasLines);
+    sem_destroy(&engine->hasSpace);
     free(engine);
     return NULL;
 }
 
+const GameSearchHooks* CLIEngine_GetSearchHooks(CLIEngine *engine) {
+    if (!engine || !engine->isReading) return NULL;
+    return &engine->hooks;
+}
+
+/**
+ * Pop the next line of a given CLIEngine's queue into its input buffer,
+ * waiting for the reader thread if none was read yet - or read it from
+ * stdin directly if the thread couldn't be started.
+ * @param   engine      the instance to use
+ * @return  NULL at the end of stdin
+ *          the engine's input buffer otherwise
+ */
+char* popInputLine(CLIEngine *engine) {
+    if (!engine->isReading) return fgets(engine->input, GAME_COMMAND_MAX_LINE_LENGTH, stdin);
+    if (engine->isEnded) return NULL;
+    while (sem_wait(&engine->hasLines) != 0); // interrupted by a signal
+    InputLine *line = &engine->lines[engine->head % INPUT_QUEUE_SIZE];
+    engine->isEnded = line->isEnd;
+    if (!engine->isEnded) strcpy(engine->input, line->text);
+    __atomic_store_n(&engine->head, engine->head + 1, __ATOMIC_RELEASE);
+    sem_post(&engine->hasSpace);
+    return engine->isEnded ? NULL : engine->input;
+}
+
 GameCommandType strToCommandType(const char *str) {
     if (!strcmp(str, "game_mode"))          return GAME_COMMAND_GAME_MODE;
     if (!strcmp(str, "difficulty"))         return GAME_COMMAND_DIFFICULTY;
     if (!strcmp(str, "user_color"))         return GAME_COMMAND_USER_COLOR;
     if (!strcmp(str, "load"))               return GAME_COMMAND_LOAD_GAME;
+    if (!strcmp(str, "position"))           return GAME_COMMAND_POSITION;
     if (!strcmp(str, "default"))            return GAME_COMMAND_DEFAULT_SETTINGS;
     if (!strcmp(str, "print_settings"))     return GAME_COMMAND_PRINT_SETTINGS;
     if (!strcmp(str, "start"))              return GAME_COMMAND_START;
     if (!strcmp(str, "move"))               return GAME_COMMAND_MOVE;
     if (!strcmp(str, "get_moves"))          return GAME_COMMAND_GET_MOVES;
     if (!strcmp(str, "save"))               return GAME_COMMAND_SAVE;
+    if (!strcmp(str, "export"))             return GAME_COMMAND_EXPORT;
     if (!strcmp(str, "undo"))               return GAME_COMMAND_UNDO;
     if (!strcmp(str, "reset"))              return GAME_COMMAND_RESET;
     if (!strcmp(str, "quit"))               return GAME_COMMAND_QUIT;
@@ -66,6 +206,7 @@ GameCommandType strToCommandType(const char *str) {
 typedef enum GameCommandArgsType {
     COMMAND_ARGS_INTS,
     COMMAND_ARGS_STRING,
+    COMMAND_ARGS_LINE,
     COMMAND_ARGS_MOVES,
     COMMAND_ARGS_NONE,
 } GameCommandArgsType;
@@ -79,8 +220,12 @@ GameCommandArgsType getCommandArgsType(const GameCommandType commandType) {
             return COMMAND_ARGS_INTS;
         // COMMAND_ARGS_STRING
         case GAME_COMMAND_SAVE:
+        case GAME_COMMAND_EXPORT:
         case GAME_COMMAND_LOAD_GAME:
             return COMMAND_ARGS_STRING;
+        // COMMAND_ARGS_LINE
+        case GAME_COMMAND_POSITION:
+            return COMMAND_ARGS_LINE;
         // COMMAND_ARGS_MOVES
         case GAME_COMMAND_MOVE:
         case GAME_COMMAND_GET_MOVES:
@@ -114,11 +259,17 @@ GameCommand CLIEngine_ProcessInput(CLIEngine *this) {
     GameCommand command = { .type = GAME_COMMAND_INVALID, .args = {-1} };
     if (!this) return command;
     char* input;
-    while ((input = fgets(this->input, GAME_COMMAND_MAX_LINE_LENGTH, stdin))) {
+    while ((input = popInputLine(this))) {
         if (input[0] == '\n') continue; // handle newline (only) input
+        if (isInputCommand(input, "stop")) continue; // only stops the AI's search
         else break;
     }
-    if (!input) return command;
+    if (!input) {
+        if (this->isJson) command.type = GAME_COMMAND_QUIT; // no one to answer
+        return command;
+    }
+    this->isAnswering = true;
+    this->commandTime = getInputTime();
     unsigned int lastCharIndex = strlen(this->input) - 1;
     if (this->input[lastCharIndex] == '\n') {
         this->input[lastCharIndex] = '\0';  // trim possible EOL char
@@ -147,6 +298,14 @@ GameCommand CLIEngine_ProcessInput(CLIEngine *this) {
             }
             strcpy(command.path, token);
             break;
+        case COMMAND_ARGS_LINE:
+            token = strtok(NULL, "");  // the rest of the line, e.g. a FEN record
+            if (!token) {
+                command.type = GAME_COMMAND_INVALID;
+                break;
+            }
+            strcpy(command.path, token);
+            break;
         case COMMAND_ARGS_MOVES:
             token = strtok(NULL, INPUT_DELIMITERS);
             if (!token || strlen(token) != 5 || token[0] != '<' ||
@@ -192,6 +351,7 @@ static const struct GameErrorToString {
     { GAME_ERROR_INVALID_DIFF_LEVEL, "Wrong difficulty level. The value should be between 1 to 5\n" },
     { GAME_ERROR_INVALID_USER_COLOR, "Wrong user color. The value should be 0 or 1\n" },
     { GAME_ERROR_INVALID_FILE, "ERROR: File doesn’t exist or cannot be opened\n" },
+    { GAME_ERROR_INVALID_FEN, "ERROR: invalid FEN record\n" },
     { GAME_ERROR_INVALID_POSITION, "Invalid position on the board\n" },
     { GAME_ERROR_EMPTY_POSITION, "The specified position does not contain your piece\n" },
     { GAME_ERROR_NOT_CONTAIN_PLAYER_PIECE, "The specified position does not contain a player piece\n"},
@@ -268,6 +428,7 @@ void CLIEngine_Render(const GameManager *manager, const GameCommand command) {
             }
             break;
         case GAME_COMMAND_LOAD_GAME:
+        case GAME_COMMAND_POSITION:
             break;
         case GAME_COMMAND_DEFAULT_SETTINGS:
             printf(MSG_DEFAULT_SETTINGS);
@@ -327,6 +488,10 @@ void CLIEngine_Render(const GameManager *manager, const GameCommand command) {
             printf(MSG_GAME_SAVED, command.path);
             printf(MSG_MAKE_MOVE, ChessColorToString[manager->game->turn].string);
             break;
+        case GAME_COMMAND_EXPORT:
+            printf(MSG_GAME_EXPORTED, command.path);
+            printf(MSG_MAKE_MOVE, ChessColorToString[manager->game->turn].string);
+            break;
         case GAME_COMMAND_UNDO:
             isAIMove = ArrayStack_Size(manager->moves) == 1;
             while (!ArrayStack_IsEmpty(manager->moves)) {
@@ -354,3 +519,181 @@ void CLIEngine_Render(const GameManager *manager, const GameCommand command) {
             break;
     }
 }
+
+/**
+ * A JSON response, assembled in full before it's written.
+ */
+typedef struct JsonResponse {
+    char data[JSON_RESPONSE_SIZE];
+    size_t length;
+} JsonResponse;
+
+/**
+ * Append a formatted string to a given JSON response.
+ * @param   response    the response to append to
+ * @param   format      the string's printf format
+ */
+void appendJson(JsonResponse *response, const char *format, ...) {
+    size_t space = sizeof(response->data) - response->length;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(response->data + response->length, space, format, args);
+    va_end(args);
+    if (length > 0) response->length += (size_t)length < space ? (size_t)length : space - 1;
+}
+
+/**
+ * Append a given string to a given JSON response as a JSON string, without
+ * the trailing newline of the CLI's messages.
+ * @param   response    the response to append to
+ * @param   string      the string to append
+ */
+void appendJsonString(JsonResponse *response, const char *string) {
+    appendJson(response, "\"");
+    for (const char *c = string; *c && strcmp(c, "\n"); c++) {
+        if (*c == '"' || *c == '\\') {
+            appendJson(response, "\\%c", *c);
+        } else if ((unsigned char)*c < ' ') {
+            appendJson(response, "\\u%04x", *c);
+        } else {
+            appendJson(response, "%c", *c);
+        }
+    }
+    appendJson(response, "\"");
+}
+
+/**
+ * Append a given move command's move to a given JSON response.
+ * @param   response    the response to append to
+ * @param   command     a move command, its args as parsed from CLI
+ */
+void appendJsonMove(JsonResponse *response, const GameCommand *command) {
+    appendJson(response, "{\"from\":\"%c%d\",\"to\":\"%c%d\"",
+               command->args[1] - 'A' + 'a', command->args[0],
+               command->args[3] - 'A' + 'a', command->args[2]);
+}
+
+/**
+ * Retrieve the CLI name of a given command type.
+ * @param   type        the command type
+ * @return  the command as typed, "invalid" if it has no CLI name
+ */
+const char* commandTypeToStr(GameCommandType type) {
+    switch (type) {
+        case GAME_COMMAND_GAME_MODE:        return "game_mode";
+        case GAME_COMMAND_DIFFICULTY:       return "difficulty";
+        case GAME_COMMAND_USER_COLOR:       return "user_color";
+        case GAME_COMMAND_LOAD_GAME:        return "load";
+        case GAME_COMMAND_POSITION:         return "position";
+        case GAME_COMMAND_DEFAULT_SETTINGS: return "default";
+        case GAME_COMMAND_PRINT_SETTINGS:   return "print_settings";
+        case GAME_COMMAND_START:            return "start";
+        case GAME_COMMAND_MOVE:             return "move";
+        case GAME_COMMAND_GET_MOVES:        return "get_moves";
+        case GAME_COMMAND_SAVE:             return "save";
+        case GAME_COMMAND_EXPORT:           return "export";
+        case GAME_COMMAND_UNDO:             return "undo";
+        case GAME_COMMAND_RESET:            return "reset";
+        case GAME_COMMAND_QUIT:             return "quit";
+        default:                            return "invalid";
+    }
+}
+
+/**
+ * Check whether the AI plays next in a given GameManager's game, so the
+ * response to the last command waits for its reply.
+ * @param   manager     the game state
+ * @return  true        if the computer is to move in a running game
+ *          false       otherwise
+ */
+bool isAIReplying(const GameManager *manager) {
+    return manager->error == GAME_ERROR_NONE && manager->phase == GAME_PHASE_RUNNING &&
+           manager->status != GAME_STATUS_CHECKMATE && manager->status != GAME_STATUS_DRAW &&
+           manager->game->mode == CHESS_MODE_1_PLAYER &&
+           manager->game->turn != manager->game->userColor;
+}
+
+void CLIEngine_RenderJson(CLIEngine *engine, const GameManager *manager, const GameCommand command) {
+    if (!engine || !manager || !engine->isAnswering) return;
+    if (!engine->isPending && isAIReplying(manager)) {
+        engine->pendingCommand = command;
+        engine->isPending = true;
+        return;
+    }
+    const GameCommand *answered = engine->isPending ? &engine->pendingCommand : &command;
+    static const char *phases[] = { "settings", "game", "error", "quit" };
+    static const char *statuses[] = { "running", "check", "checkmate", "draw" };
+    JsonResponse response = { .length = 0 };
+    appendJson(&response, "{\"command\":\"%s\",\"ok\":%s",
+               commandTypeToStr(answered->type), manager->error ? "false" : "true");
+    if (manager->error) {
+        appendJson(&response, ",\"error\":");
+        appendJsonString(&response, GameErrorToString[manager->error].string);
+    } else {
+        switch (answered->type) {
+            case GAME_COMMAND_GAME_MODE:
+            case GAME_COMMAND_DIFFICULTY:
+            case GAME_COMMAND_USER_COLOR:
+            case GAME_COMMAND_DEFAULT_SETTINGS:
+            case GAME_COMMAND_PRINT_SETTINGS:
+                appendJson(&response, ",\"settings\":{\"game_mode\":%d,\"difficulty\":%d,\"user_color\":\"%s\"}",
+                           manager->game->mode, manager->game->difficulty,
+                           ChessColorToString[manager->game->userColor].string);
+                break;
+            case GAME_COMMAND_MOVE:
+                appendJson(&response, ",\"move\":");
+                appendJsonMove(&response, answered);
+                appendJson(&response, "}");
+                break;
+            case GAME_COMMAND_GET_MOVES:
+                appendJson(&response, ",\"moves\":[");
+                for (unsigned int i = 0; i < ArrayStack_Size(manager->moves); i++) {
+                    const ChessPos *pos = ArrayStack_Get(manager->moves, i);
+                    appendJson(&response, "%s{\"to\":\"%c%d\",\"threatened\":%s,\"captures\":%s}",
+                               i ? "," : "", pos->x + 'a', pos->y + 1,
+                               pos->type == CHESS_POS_THREATENED || pos->type == CHESS_POS_BOTH ? "true" : "false",
+                               pos->type == CHESS_POS_CAPTURE || pos->type == CHESS_POS_BOTH ? "true" : "false");
+                }
+                appendJson(&response, "]");
+                break;
+            case GAME_COMMAND_SAVE:
+            case GAME_COMMAND_EXPORT:
+                appendJson(&response, ",\"path\":");
+                appendJsonString(&response, answered->path);
+                break;
+            case GAME_COMMAND_UNDO:
+                appendJson(&response, ",\"undone\":[");
+                for (unsigned int i = ArrayStack_Size(manager->moves); i > 0; i--) {
+                    const ChessMove *move = ArrayStack_Get(manager->moves, i - 1);
+                    appendJson(&response, "%s{\"player\":\"%s\",\"from\":\"%c%d\",\"to\":\"%c%d\"}",
+                               i == ArrayStack_Size(manager->moves) ? "" : ",",
+                               ChessColorToString[move->player].string,
+                               move->from.x + 'a', move->from.y + 1, move->to.x + 'a', move->to.y + 1);
+                }
+                appendJson(&response, "]");
+                break;
+            default:
+                break;
+        }
+        if (engine->isPending) { // the command is the AI's move
+            appendJson(&response, ",\"reply\":");
+            appendJsonMove(&response, &command);
+            appendJson(&response, ",\"piece\":\"%s\",\"nodes\":%lu}",
+                       chessPieceLocationToStr(manager->game, command.args[3] - 'A', command.args[2] - 1),
+                       manager->stats.nodes);
+        }
+    }
+    char fen[CHESS_FEN_SIZE];
+    ChessGame_ToFEN(manager->game, fen);
+    appendJson(&response, ",\"phase\":\"%s\",\"status\":\"%s\",\"turn\":\"%s\",\"fen\":\"%s\",\"ms\":%lld}\n",
+               phases[manager->phase], statuses[manager->status],
+               ChessColorToString[manager->game->turn].string, fen,
+               engine->isTimed ? (getInputTime() - engine->commandTime) / 1000 : 0);
+    if (response.data[response.length - 1] != '\n') response.data[response.length - 1] = '\n'; // cut
+    for (size_t written = 0; written < response.length;) { // a single write, unless interrupted
+        ssize_t length = write(STDOUT_FILENO, response.data + written, response.length - written);
+        if (length < 0) break;
+        written += length;
+    }
+    engine->isAnswering = engine->isPending = false;
+}
@@ -9,10 +9,13 @@ typedef struct CLIEngine CLIEngine;
 
 /**
  * Create new CLIEngine instance.
+ * @param   isJson      whether to answer in JSON lines, see CLIEngine_RenderJson()
+ * @param   isTimed     whether JSON answers carry the time their command took,
+ *                      otherwise 0, so a session's answers are reproducible
  * @return  NULL if malloc failed
  *          CLIEngine* instance otherwise
  */
-CLIEngine* CLIEngine_Create();
+CLIEngine* CLIEngine_Create(bool isJson, bool isTimed);
 
 /**
  * Free all resources for a given CLIEngine instance.
@@ -21,6 +24,17 @@ CLIEngine* CLIEngine_Create();
  */
 CLIEngine* CLIEngine_Destroy(CLIEngine *engine);
 
+/**
+ * Retrieve the search hooks that stop a given CLIEngine's AI search once
+ * a "quit" or a "stop" command is read - stdin is read by a thread of
+ * its own, so commands are read while the AI is thinking.
+ * @param   engine      the instance to use
+ * @return  NULL if engine == NULL or its reader thread couldn't be started
+ *          the hooks otherwise, to be used from the thread calling
+ *          CLIEngine_ProcessInput()
+ */
+const GameSearchHooks* CLIEngine_GetSearchHooks(CLIEngine *engine);
+
 /**
  * Get and parse user input from stdin.
  * @param   engine      the instance to use
@@ -45,4 +59,18 @@ void CLIEngine_RenderError(const GameManager *manager, bool toRenderEnterMove);
 void CLIEngine_Render(const GameManager *manager, const GameCommand command);
 
 
+/**
+ * Output to CLI a single-line JSON object answering the last command read,
+ * written at once: its "command", "ok", either the "error" or the command's
+ * result ("settings", "move", "moves", "path" or "undone"), the game's
+ * "phase", "status", "turn" and "fen", and the whole "ms" it took. In a 1-player
+ * game, the response to a command the AI replies to waits for the AI's move,
+ * its "reply". Nothing is written for the AI's own commands.
+ * @param   engine      the instance to use
+ * @param   gameManager the game state to output
+ * @param   command     the last command processed
+ */
+void CLIEngine_RenderJson(CLIEngine *engine, const GameManager *manager, const GameCommand command);
+
+
 #endif
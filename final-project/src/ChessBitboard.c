@@ -0,0 +1,131 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include "ChessBitboard.h"
+
+#define DIRECTIONS          8
+#define FILE_A              0x0101010101010101ULL
+#define FILE_H              (FILE_A << (CHESS_GRID - 1))
+
+
+typedef enum Direction {
+    DIRECTION_NORTH,
+    DIRECTION_EAST,
+    DIRECTION_NORTH_EAST,
+    DIRECTION_NORTH_WEST,
+    DIRECTION_SOUTH,
+    DIRECTION_WEST,
+    DIRECTION_SOUTH_WEST,
+    DIRECTION_SOUTH_EAST,
+} Direction;
+
+// the first half of the directions runs towards higher squares
+static const int directionX[DIRECTIONS] = { 0, 1, 1, -1, 0, -1, -1, 1 };
+static const int directionY[DIRECTIONS] = { 1, 0, 1, 1, -1, 0, -1, -1 };
+
+static ChessBitboard rays[DIRECTIONS][CHESS_SQUARES];
+static ChessBitboard knightAttacks[CHESS_SQUARES];
+static ChessBitboard kingAttacks[CHESS_SQUARES];
+static pthread_once_t attackTablesOnce = PTHREAD_ONCE_INIT;
+
+bool isOnBoard(int x, int y) {
+    return x >= 0 && x < CHESS_GRID && y >= 0 && y < CHESS_GRID;
+}
+
+/**
+ * Fill the attack tables. Done once, on first use - by whichever thread
+ * gets there first, through pthread_once().
+ */
+void initAttackTables() {
+    static const int knightX[] = { 1, 2, 2, 1, -1, -2, -2, -1 };
+    static const int knightY[] = { 2, 1, -1, -2, -2, -1, 1, 2 };
+    for (int square = 0; square < CHESS_SQUARES; square++) {
+        int x = CHESS_SQUARE_X(square), y = CHESS_SQUARE_Y(square);
+        for (int i = 0; i < DIRECTIONS; i++) {
+            rays[i][square] = 0;
+            for (int j = x + directionX[i], k = y + directionY[i];
+                 isOnBoard(j, k);
+                 j += directionX[i], k += directionY[i]) {
+                rays[i][square] |= CHESS_BITBOARD(CHESS_SQUARE(j, k));
+            }
+            if (isOnBoard(x + directionX[i], y + directionY[i])) {
+                kingAttacks[square] |= CHESS_BITBOARD(CHESS_SQUARE(x + directionX[i], y + directionY[i]));
+            }
+            if (isOnBoard(x + knightX[i], y + knightY[i])) {
+                knightAttacks[square] |= CHESS_BITBOARD(CHESS_SQUARE(x + knightX[i], y + knightY[i]));
+            }
+        }
+    }
+}
+
+/**
+ * Retrieve the attacks along a given direction's ray, up to (and including)
+ * the first blocker.
+ */
+ChessBitboard getRayAttacks(Direction direction, int square, ChessBitboard occupied) {
+    ChessBitboard attacks = rays[direction][square];
+    ChessBitboard blockers = attacks & occupied;
+    if (!blockers) return attacks;
+    int blocker = direction < DIRECTIONS / 2
+        ? __builtin_ctzll(blockers)             // nearest is the lowest square
+        : 63 - __builtin_clzll(blockers);       // nearest is the highest square
+    return attacks ^ rays[direction][blocker];
+}
+
+ChessBitboard getRookAttacks(int square, ChessBitboard occupied) {
+    return getRayAttacks(DIRECTION_NORTH, square, occupied) |
+           getRayAttacks(DIRECTION_EAST, square, occupied) |
+           getRayAttacks(DIRECTION_SOUTH, square, occupied) |
+           getRayAttacks(DIRECTION_WEST, square, occupied);
+}
+
+ChessBitboard getBishopAttacks(int square, ChessBitboard occupied) {
+    return getRayAttacks(DIRECTION_NORTH_EAST, square, occupied) |
+           getRayAttacks(DIRECTION_NORTH_WEST, square, occupied) |
+           getRayAttacks(DIRECTION_SOUTH_EAST, square, occupied) |
+           getRayAttacks(DIRECTION_SOUTH_WEST, square, occupied);
+}
+
+ChessBitboard ChessBitboard_GetAttacks(ChessPiece piece, int square, ChessBitboard occupied) {
+    pthread_once(&attackTablesOnce, initAttackTables);
+    switch (piece) {
+        case CHESS_PIECE_WHITE_PAWN:
+            return ChessBitboard_GetPawnsAttacks(CHESS_BITBOARD(square), CHESS_PLAYER_COLOR_WHITE);
+        case CHESS_PIECE_BLACK_PAWN:
+            return ChessBitboard_GetPawnsAttacks(CHESS_BITBOARD(square), CHESS_PLAYER_COLOR_BLACK);
+        case CHESS_PIECE_WHITE_KNIGHT:
+        case CHESS_PIECE_BLACK_KNIGHT:
+            return knightAttacks[square];
+        case CHESS_PIECE_WHITE_BISHOP:
+        case CHESS_PIECE_BLACK_BISHOP:
+            return getBishopAttacks(square, occupied);
+        case CHESS_PIECE_WHITE_ROOK:
+        case CHESS_PIECE_BLACK_ROOK:
+            return getRookAttacks(square, occupied);
+        case CHESS_PIECE_WHITE_QUEEN:
+        case CHESS_PIECE_BLACK_QUEEN:
+            return getRookAttacks(square, occupied) | getBishopAttacks(square, occupied);
+        case CHESS_PIECE_WHITE_KING:
+        case CHESS_PIECE_BLACK_KING:
+            return kingAttacks[square];
+        case CHESS_PIECE_NONE:
+        default:
+            return 0;
+    }
+}
+
+ChessBitboard ChessBitboard_GetPawnsAttacks(ChessBitboard pawns, ChessColor color) {
+    if (color == CHESS_PLAYER_COLOR_WHITE) {
+        return ((pawns & ~FILE_A) << (CHESS_GRID - 1)) | ((pawns & ~FILE_H) << (CHESS_GRID + 1));
+    }
+    return ((pawns & ~FILE_A) >> (CHESS_GRID + 1)) | ((pawns & ~FILE_H) >> (CHESS_GRID - 1));
+}
+
+int ChessBitboard_Count(ChessBitboard bitboard) {
+    return __builtin_popcountll(bitboard);
+}
+
+int ChessBitboard_PopSquare(ChessBitboard *bitboard) {
+    int square = __builtin_ctzll(*bitboard);
+    *bitboard &= *bitboard - 1;
+    return square;
+}
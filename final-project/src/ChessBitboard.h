@@ -0,0 +1,54 @@
+#ifndef CHESS_BITBOARD_H_
+#define CHESS_BITBOARD_H_
+
+#include <stdint.h>
+#include "ChessGame.h"
+
+#define CHESS_SQUARES               (CHESS_GRID * CHESS_GRID)
+#define CHESS_SQUARE(x, y)          ((y) * CHESS_GRID + (x))
+#define CHESS_SQUARE_X(square)      ((square) % CHESS_GRID)
+#define CHESS_SQUARE_Y(square)      ((square) / CHESS_GRID)
+#define CHESS_BITBOARD(square)      ((ChessBitboard)1 << (square))
+
+
+/**
+ * A set of squares, bit CHESS_SQUARE(x, y) standing for location (x, y).
+ */
+typedef uint64_t ChessBitboard;
+
+/**
+ * Retrieve the squares a given ChessPiece attacks from a given square.
+ * Sliding pieces are blocked by (and attack) the first occupied square
+ * in each direction. Pawns attack diagonally forward only.
+ * @param   piece       the attacking piece
+ * @param   square      the piece's square
+ * @param   occupied    the occupied squares
+ * @return  0           if piece == CHESS_PIECE_NONE
+ *          the attacked squares otherwise
+ */
+ChessBitboard ChessBitboard_GetAttacks(ChessPiece piece, int square, ChessBitboard occupied);
+
+/**
+ * Retrieve the squares attacked by all the pawns in a given set.
+ * @param   pawns       the pawns' squares
+ * @param   color       the pawns' color
+ * @return  the attacked squares
+ */
+ChessBitboard ChessBitboard_GetPawnsAttacks(ChessBitboard pawns, ChessColor color);
+
+/**
+ * Count the squares in a given set.
+ * @param   bitboard    the set to count
+ * @return  the number of squares
+ */
+int ChessBitboard_Count(ChessBitboard bitboard);
+
+/**
+ * Remove the lowest square from a given non-empty set.
+ * @param   bitboard    the set to remove the square from
+ * @return  the removed square
+ */
+int ChessBitboard_PopSquare(ChessBitboard *bitboard);
+
+
+#endif
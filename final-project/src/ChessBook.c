@@ -0,0 +1,187 @@
+#define _POSIX_C_SOURCE 200809L // mmap()
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ChessBook.h"
+
+#define MOVE_FIELD_BITS     3
+#define MOVE_FIELD_MASK     ((1 << MOVE_FIELD_BITS) - 1)
+
+
+static void *mapping = NULL;
+static size_t mappingSize = 0;
+static size_t entriesCount = 0;
+
+/**
+ * Read a big-endian unsigned integer.
+ * @param   bytes       the integer's bytes
+ * @param   size        the number of bytes
+ * @return  the integer
+ */
+uint64_t readBigEndian(const unsigned char *bytes, int size) {
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+/**
+ * Write a big-endian unsigned integer.
+ * @param   bytes       output parameter for the integer's bytes
+ * @param   value       the integer
+ * @param   size        the number of bytes
+ */
+void writeBigEndian(unsigned char *bytes, uint64_t value, int size) {
+    for (int i = size - 1; i >= 0; i--) {
+        bytes[i] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+/**
+ * Read an entry of the loaded book.
+ * @param   index       the entry's index, must be < entriesCount
+ * @param   entry       output parameter for the entry
+ */
+void readEntry(size_t index, ChessBookEntry *entry) {
+    const unsigned char *bytes = (const unsigned char *)mapping + index * CHESS_BOOK_ENTRY_SIZE;
+    entry->key = readBigEndian(bytes, 8);
+    entry->move = readBigEndian(bytes + 8, 2);
+    entry->weight = readBigEndian(bytes + 10, 2);
+    entry->learn = readBigEndian(bytes + 12, 4);
+}
+
+/**
+ * Find the first entry of a given key in the loaded book.
+ * @param   key         the key to look for
+ * @return  the index of the first entry with a key >= the given key
+ */
+size_t findFirstEntry(uint64_t key) {
+    size_t low = 0, high = entriesCount;
+    ChessBookEntry entry;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        readEntry(middle, &entry);
+        if (entry.key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * Pick a random number in a given range, for weights beyond RAND_MAX.
+ * @param   range       the size of the range, must be > 0
+ * @return  a random number in [0, range)
+ */
+unsigned long getRandom(unsigned long range) {
+    unsigned long value = (unsigned long)rand() * ((unsigned long)RAND_MAX + 1) + rand();
+    return value % range;
+}
+
+/**
+ * Check whether a given move is valid in a given ChessGame, as books may
+ * have been built with other rules or have colliding keys.
+ * @param   game        the game to check the move in
+ * @param   move        the move to check
+ * @return  true        if the move is valid
+ *          false       otherwise
+ */
+bool isValidBookMove(const ChessGame *game, ChessMove move) {
+    ChessGame *gameCopy = ChessGame_Copy(game);
+    if (!gameCopy) return false;
+    bool isValid = ChessGame_DoMove(gameCopy, move) == CHESS_SUCCESS;
+    ChessGame_Destroy(gameCopy);
+    return isValid;
+}
+
+uint16_t ChessBook_EncodeMove(ChessMove move) {
+    return move.to.x |
+           move.to.y << MOVE_FIELD_BITS |
+           move.from.x << (2 * MOVE_FIELD_BITS) |
+           move.from.y << (3 * MOVE_FIELD_BITS);
+}
+
+ChessMove ChessBook_DecodeMove(uint16_t bookMove) {
+    ChessMove move = { .capturedPiece = CHESS_PIECE_NONE };
+    move.to.x = bookMove & MOVE_FIELD_MASK;
+    move.to.y = (bookMove >> MOVE_FIELD_BITS) & MOVE_FIELD_MASK;
+    move.from.x = (bookMove >> (2 * MOVE_FIELD_BITS)) & MOVE_FIELD_MASK;
+    move.from.y = (bookMove >> (3 * MOVE_FIELD_BITS)) & MOVE_FIELD_MASK;
+    return move;
+}
+
+bool ChessBook_WriteEntry(FILE *file, const ChessBookEntry *entry) {
+    if (!file || !entry) return false;
+    unsigned char bytes[CHESS_BOOK_ENTRY_SIZE];
+    writeBigEndian(bytes, entry->key, 8);
+    writeBigEndian(bytes + 8, entry->move, 2);
+    writeBigEndian(bytes + 10, entry->weight, 2);
+    writeBigEndian(bytes + 12, entry->learn, 4);
+    return fwrite(bytes, CHESS_BOOK_ENTRY_SIZE, 1, file) == 1;
+}
+
+bool ChessBook_Load(const char *path) {
+    ChessBook_Unload();
+    if (!path) return false;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0 &&
+        status.st_size % CHESS_BOOK_ENTRY_SIZE == 0) {
+        mappingSize = status.st_size;
+        mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) mapping = NULL;
+    }
+    close(fd); // the mapping stays valid
+    if (!mapping) {
+        ChessBook_Unload();
+        return false;
+    }
+    entriesCount = mappingSize / CHESS_BOOK_ENTRY_SIZE;
+    return true;
+}
+
+void ChessBook_Unload() {
+    if (mapping) munmap(mapping, mappingSize);
+    mapping = NULL;
+    mappingSize = 0;
+    entriesCount = 0;
+}
+
+bool ChessBook_IsLoaded() {
+    return mapping != NULL;
+}
+
+bool ChessBook_Probe(const ChessGame *game, ChessMove *move) {
+    if (!game || !move || !mapping) return false;
+    size_t first = findFirstEntry(game->hash);
+    unsigned long totalWeight = 0;
+    ChessBookEntry entry;
+    size_t last;
+    for (last = first; last < entriesCount; last++) {
+        readEntry(last, &entry);
+        if (entry.key != game->hash) break;
+        totalWeight += entry.weight;
+    }
+    if (totalWeight == 0) return false;
+    unsigned long pick = getRandom(totalWeight);
+    for (size_t i = first; i < last; i++) {
+        readEntry(i, &entry);
+        if (pick >= entry.weight) {
+            pick -= entry.weight;
+            continue;
+        }
+        ChessMove bookMove = ChessBook_DecodeMove(entry.move);
+        if (!isValidBookMove(game, bookMove)) return false;
+        *move = bookMove;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,83 @@
+#ifndef CHESS_BOOK_H_
+#define CHESS_BOOK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "ChessGame.h"
+
+#define CHESS_BOOK_ENTRY_SIZE   16 // bytes per entry in a book file
+
+
+/**
+ * An opening book entry: a big-endian 64-bit key, 16-bit move, 16-bit weight
+ * and 32-bit learn value. Entries are sorted by key, so all of a position's
+ * moves are adjacent.
+ * The key is the engine's own Zobrist hash of the position (ChessGame.hash),
+ * so books are built from this engine's games (by tools/bookgen). This isn't
+ * a Polyglot book reader: the record layout is the same, but Polyglot books
+ * are keyed by another hash, and won't match any position.
+ */
+typedef struct ChessBookEntry {
+    uint64_t key;
+    uint16_t move; // to file, to row, from file, from row - 3 bits each, from the lowest
+    uint16_t weight; // the relative chance of playing the move, never played if 0
+    uint32_t learn; // unused
+} ChessBookEntry;
+
+/**
+ * Encode a given move as a book entry move.
+ * @param   move        the move to encode
+ * @return  the encoded move
+ */
+uint16_t ChessBook_EncodeMove(ChessMove move);
+
+/**
+ * Decode a given book entry move.
+ * @param   bookMove    the encoded move
+ * @return  the move, with only its from & to positions set
+ */
+ChessMove ChessBook_DecodeMove(uint16_t bookMove);
+
+/**
+ * Append an entry to a book file. Entries must be written in key order.
+ * @param   file        the book file, open for writing
+ * @param   entry       the entry to write
+ * @return  true        if the entry was written
+ *          false       otherwise
+ */
+bool ChessBook_WriteEntry(FILE *file, const ChessBookEntry *entry);
+
+/**
+ * Memory-map an opening book file, replacing any loaded book.
+ * @param   path        the book file path
+ * @return  true        if the book was loaded
+ *          false       if the file can't be mapped or isn't a whole number of entries
+ */
+bool ChessBook_Load(const char *path);
+
+/**
+ * Unmap the book, if loaded.
+ */
+void ChessBook_Unload();
+
+/**
+ * Signal if a book is loaded.
+ * @return  true        if a book is loaded
+ *          false       otherwise
+ */
+bool ChessBook_IsLoaded();
+
+/**
+ * Pick a book move for the current position of a given ChessGame, at random
+ * with the chance of each of the position's moves proportional to its weight.
+ * The position is found by binary search, in O(log(entries)).
+ * @param   game        the game to pick a move for
+ * @param   move        output parameter for the picked move, won't change on a miss
+ * @return  true        if a valid move was picked
+ *          false       if no book is loaded, or it has no valid moves for the position
+ */
+bool ChessBook_Probe(const ChessGame *game, ChessMove *move);
+
+
+#endif
@@ -0,0 +1,635 @@
+#include <ctype.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "ChessEval.h"
+#include "ChessBitboard.h"
+
+#define PIECE_TYPES         6
+#define PAWN_TABLE_SIZE     (1 << 14) // must be a power of 2
+#define EVAL_CACHE_SIZE     (1 << 16) // must be a power of 2
+#define SAFETY_TABLE_SIZE   20
+#define WEIGHTS_HEADER      "# chessprog evaluation weights"
+
+
+typedef enum PieceType {
+    PIECE_TYPE_PAWN,
+    PIECE_TYPE_KNIGHT,
+    PIECE_TYPE_BISHOP,
+    PIECE_TYPE_ROOK,
+    PIECE_TYPE_QUEEN,
+    PIECE_TYPE_KING,
+    PIECE_TYPE_NONE,
+} PieceType;
+
+/**
+ * The tunable parameters of the classical evaluation, all in centipawns.
+ * Only ints, so it's also viewed as a flat array of CHESS_EVAL_WEIGHTS values,
+ * the indices ChessEvalTerm refers to.
+ */
+typedef struct Weights {
+    int midgameValues[PIECE_TYPES];
+    int endgameValues[PIECE_TYPES];
+    // piece-square tables are from white's point of view, rank 8 first
+    int midgameTables[PIECE_TYPES][CHESS_GRID * CHESS_GRID];
+    int endgameTables[PIECE_TYPES][CHESS_GRID * CHESS_GRID];
+    int doubledMidgame;
+    int doubledEndgame;
+    int isolatedMidgame;
+    int isolatedEndgame;
+    // passed pawn bonus by rank, relative to the pawn's player (a pawn can't be on the first rank)
+    int passedMidgame[CHESS_GRID];
+    int passedEndgame[CHESS_GRID];
+    // the shield is a midgame-only term
+    int shieldNear;
+    int shieldFar;
+    int shieldMissing;
+    // mobility is scored per attacked safe square above (or below) a typical count
+    int mobilityMidgame[PIECE_TYPES];
+    int mobilityEndgame[PIECE_TYPES];
+    // king safety is scored by the units of the attacks on the opponent king's zone
+    int safetyTable[SAFETY_TABLE_SIZE];
+} Weights;
+
+typedef char weightsSizeCheck[sizeof(Weights) == CHESS_EVAL_WEIGHTS * sizeof(int) ? 1 : -1];
+
+// tables shared by both phases
+#define KNIGHT_TABLE { \
+    -50, -40, -30, -30, -30, -30, -40, -50, \
+    -40, -20,   0,   0,   0,   0, -20, -40, \
+    -30,   0,  10,  15,  15,  10,   0, -30, \
+    -30,   5,  15,  20,  20,  15,   5, -30, \
+    -30,   0,  15,  20,  20,  15,   0, -30, \
+    -30,   5,  10,  15,  15,  10,   5, -30, \
+    -40, -20,   0,   5,   5,   0, -20, -40, \
+    -50, -40, -30, -30, -30, -30, -40, -50, \
+}
+
+#define BISHOP_TABLE { \
+    -20, -10, -10, -10, -10, -10, -10, -20, \
+    -10,   0,   0,   0,   0,   0,   0, -10, \
+    -10,   0,   5,  10,  10,   5,   0, -10, \
+    -10,   5,   5,  10,  10,   5,   5, -10, \
+    -10,   0,  10,  10,  10,  10,   0, -10, \
+    -10,  10,  10,  10,  10,  10,  10, -10, \
+    -10,   5,   0,   0,   0,   0,   5, -10, \
+    -20, -10, -10, -10, -10, -10, -10, -20, \
+}
+
+#define ROOK_TABLE { \
+      0,   0,   0,   0,   0,   0,   0,   0, \
+      5,  10,  10,  10,  10,  10,  10,   5, \
+     -5,   0,   0,   0,   0,   0,   0,  -5, \
+     -5,   0,   0,   0,   0,   0,   0,  -5, \
+     -5,   0,   0,   0,   0,   0,   0,  -5, \
+     -5,   0,   0,   0,   0,   0,   0,  -5, \
+     -5,   0,   0,   0,   0,   0,   0,  -5, \
+      0,   0,   0,   5,   5,   0,   0,   0, \
+}
+
+#define QUEEN_TABLE { \
+    -20, -10, -10,  -5,  -5, -10, -10, -20, \
+    -10,   0,   0,   0,   0,   0,   0, -10, \
+    -10,   0,   5,   5,   5,   5,   0, -10, \
+     -5,   0,   5,   5,   5,   5,   0,  -5, \
+      0,   0,   5,   5,   5,   5,   0,  -5, \
+    -10,   5,   5,   5,   5,   5,   0, -10, \
+    -10,   0,   5,   0,   0,   0,   0, -10, \
+    -20, -10, -10,  -5,  -5, -10, -10, -20, \
+}
+
+static union {
+    Weights named;
+    int values[CHESS_EVAL_WEIGHTS];
+} weights = { .named = {
+    .midgameValues = { 100, 300, 300, 500, 900, 10000 },
+    .endgameValues = { 120, 280, 310, 520, 920, 10000 },
+    .midgameTables = {
+        { // pawn
+              0,   0,   0,   0,   0,   0,   0,   0,
+             50,  50,  50,  50,  50,  50,  50,  50,
+             10,  10,  20,  30,  30,  20,  10,  10,
+              5,   5,  10,  25,  25,  10,   5,   5,
+              0,   0,   0,  20,  20,   0,   0,   0,
+              5,  -5, -10,   0,   0, -10,  -5,   5,
+              5,  10,  10, -20, -20,  10,  10,   5,
+              0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        KNIGHT_TABLE,
+        BISHOP_TABLE,
+        ROOK_TABLE,
+        QUEEN_TABLE,
+        { // king
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -20, -30, -30, -40, -40, -30, -30, -20,
+            -10, -20, -20, -20, -20, -20, -20, -10,
+             20,  20,   0,   0,   0,   0,  20,  20,
+             20,  30,  10,   0,   0,  10,  30,  20,
+        },
+    },
+    .endgameTables = {
+        { // pawns don't promote, so advancing them is worth less than in regular chess
+              0,   0,   0,   0,   0,   0,   0,   0,
+             40,  40,  40,  40,  40,  40,  40,  40,
+             30,  30,  30,  30,  30,  30,  30,  30,
+             20,  20,  20,  20,  20,  20,  20,  20,
+             10,  10,  10,  10,  10,  10,  10,  10,
+              5,   5,   5,   5,   5,   5,   5,   5,
+              0,   0,   0,   0,   0,   0,   0,   0,
+              0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        KNIGHT_TABLE,
+        BISHOP_TABLE,
+        ROOK_TABLE,
+        QUEEN_TABLE,
+        { // an active, centralized king is an asset once most pieces are traded
+            -50, -40, -30, -20, -20, -30, -40, -50,
+            -30, -20, -10,   0,   0, -10, -20, -30,
+            -30, -10,  20,  30,  30,  20, -10, -30,
+            -30, -10,  30,  40,  40,  30, -10, -30,
+            -30, -10,  30,  40,  40,  30, -10, -30,
+            -30, -10,  20,  30,  30,  20, -10, -30,
+            -30, -30,   0,   0,   0,   0, -30, -30,
+            -50, -30, -30, -30, -30, -30, -30, -50,
+        },
+    },
+    .doubledMidgame = -10,
+    .doubledEndgame = -20,
+    .isolatedMidgame = -10,
+    .isolatedEndgame = -15,
+    .passedMidgame = { 0, 5, 5, 10, 15, 20, 30, 0 },
+    .passedEndgame = { 0, 10, 10, 15, 25, 35, 50, 0 },
+    .shieldNear = 10,
+    .shieldFar = 5,
+    .shieldMissing = -10,
+    .mobilityMidgame = { 0, 4, 5, 2, 1, 0 },
+    .mobilityEndgame = { 0, 4, 5, 4, 2, 0 },
+    .safetyTable = {
+        0, 0, 2, 5, 9, 14, 20, 27, 35, 44, 54, 65, 77, 90, 100, 110, 120, 130, 140, 150,
+    },
+} };
+
+// not tuned: the phase is a fixed scale, and mobility & attack units are term inputs
+static const int phaseWeights[PIECE_TYPES] = { 0, 1, 1, 2, 4, 0 };
+static const int mobilityBase[PIECE_TYPES] = { 0, 4, 6, 7, 13, 0 };
+static const int kingAttackUnits[PIECE_TYPES] = { 0, 2, 2, 3, 5, 0 };
+
+// lock-free entries: check == key ^ data, so a torn entry is just a miss;
+// both words are accessed with relaxed atomics, as searches share the tables
+typedef struct CacheEntry {
+    uint64_t check;
+    uint64_t data;
+} CacheEntry;
+
+static CacheEntry pawnTable[PAWN_TABLE_SIZE];
+static CacheEntry evalCache[EVAL_CACHE_SIZE];
+
+/**
+ * The midgame & endgame scores being summed by an evaluation, and the trace
+ * of its terms when one is requested.
+ */
+typedef struct EvalContext {
+    int midgame;
+    int endgame;
+    ChessEvalTrace *trace;
+} EvalContext;
+
+/**
+ * Retrieve the PieceType of a given ChessPiece.
+ * @param   piece       the piece to retrieve the type for
+ * @return  PIECE_TYPE_NONE if piece == CHESS_PIECE_NONE
+ *          the piece's type otherwise
+ */
+PieceType getPieceType(ChessPiece piece) {
+    switch (piece) {
+        case CHESS_PIECE_WHITE_PAWN:
+        case CHESS_PIECE_BLACK_PAWN:
+            return PIECE_TYPE_PAWN;
+        case CHESS_PIECE_WHITE_KNIGHT:
+        case CHESS_PIECE_BLACK_KNIGHT:
+            return PIECE_TYPE_KNIGHT;
+        case CHESS_PIECE_WHITE_BISHOP:
+        case CHESS_PIECE_BLACK_BISHOP:
+            return PIECE_TYPE_BISHOP;
+        case CHESS_PIECE_WHITE_ROOK:
+        case CHESS_PIECE_BLACK_ROOK:
+            return PIECE_TYPE_ROOK;
+        case CHESS_PIECE_WHITE_QUEEN:
+        case CHESS_PIECE_BLACK_QUEEN:
+            return PIECE_TYPE_QUEEN;
+        case CHESS_PIECE_WHITE_KING:
+        case CHESS_PIECE_BLACK_KING:
+            return PIECE_TYPE_KING;
+        case CHESS_PIECE_NONE:
+        default:
+            return PIECE_TYPE_NONE;
+    }
+}
+
+bool isWhitePiece(ChessPiece piece) {
+    ChessColor color;
+    ChessGame_GetPieceColor(piece, &color);
+    return color == CHESS_PLAYER_COLOR_WHITE;
+}
+
+/**
+ * Add a term to a given evaluation: a weight and its number of occurrences,
+ * recording it in the evaluation's trace if there is one.
+ * @param   context     the evaluation to add the term to
+ * @param   weight      the term's weight, pointing into weights
+ * @param   count       the term's occurrences, negative for black
+ * @param   isEndgame   whether the weight is an endgame weight
+ */
+void addTerm(EvalContext *context, const int *weight, int count, bool isEndgame) {
+    if (!count) return;
+    if (isEndgame) {
+        context->endgame += *weight * count;
+    } else {
+        context->midgame += *weight * count;
+    }
+    ChessEvalTrace *trace = context->trace;
+    if (!trace || trace->size >= CHESS_EVAL_TRACE_SIZE) return;
+    trace->terms[trace->size++] = (ChessEvalTerm){
+        .index = (uint16_t)(weight - weights.values),
+        .count = (int16_t)count,
+        .isEndgame = isEndgame,
+    };
+}
+
+/**
+ * Add a midgame & endgame pair of terms to a given evaluation.
+ * @param   context     the evaluation to add the terms to
+ * @param   midgame     the midgame weight, pointing into weights
+ * @param   endgame     the endgame weight, pointing into weights
+ * @param   count       the terms' occurrences, negative for black
+ */
+void addTerms(EvalContext *context, const int *midgame, const int *endgame, int count) {
+    addTerm(context, midgame, count, false);
+    addTerm(context, endgame, count, true);
+}
+
+/**
+ * Retrieve the piece-square table index of a given ChessPiece at a given location.
+ * @param   piece       the piece, not CHESS_PIECE_NONE
+ * @param   x           the piece's column
+ * @param   y           the piece's row
+ * @return  the index, mirrored for white so rank 1 is the table's last row
+ */
+int getTableIndex(ChessPiece piece, int x, int y) {
+    if (isWhitePiece(piece)) return (CHESS_GRID - 1 - y) * CHESS_GRID + x;
+    return y * CHESS_GRID + x;
+}
+
+/**
+ * Score a given ChessPiece at a given location using given value & table sets.
+ * @param   piece       the piece to score
+ * @param   x           the piece's column
+ * @param   y           the piece's row
+ * @param   values      the material values, indexed by PieceType
+ * @param   tables      the piece-square tables, indexed by PieceType
+ * @return  the piece's value at (x, y), negative for black pieces
+ */
+int getPieceSquareScore(ChessPiece piece, int x, int y,
+                        const int *values, int (*tables)[CHESS_GRID * CHESS_GRID]) {
+    PieceType type = getPieceType(piece);
+    if (type == PIECE_TYPE_NONE) return 0;
+    int score = values[type] + tables[type][getTableIndex(piece, x, y)];
+    return isWhitePiece(piece) ? score : -score;
+}
+
+int ChessEval_GetPieceScore(ChessPiece piece) {
+    PieceType type = getPieceType(piece);
+    if (type == PIECE_TYPE_NONE) return 0;
+    int score = weights.named.midgameValues[type];
+    return isWhitePiece(piece) ? score : -score;
+}
+
+int ChessEval_GetMidgameScore(ChessPiece piece, int x, int y) {
+    return getPieceSquareScore(piece, x, y,
+                               weights.named.midgameValues, weights.named.midgameTables);
+}
+
+int ChessEval_GetEndgameScore(ChessPiece piece, int x, int y) {
+    return getPieceSquareScore(piece, x, y,
+                               weights.named.endgameValues, weights.named.endgameTables);
+}
+
+int ChessEval_GetPhaseWeight(ChessPiece piece) {
+    PieceType type = getPieceType(piece);
+    return type == PIECE_TYPE_NONE ? 0 : phaseWeights[type];
+}
+
+int ChessEval_Taper(int midgameScore, int endgameScore, int phase) {
+    if (phase > CHESS_EVAL_PHASE_MAX) phase = CHESS_EVAL_PHASE_MAX;
+    if (phase < 0) phase = 0;
+    return (midgameScore * phase + endgameScore * (CHESS_EVAL_PHASE_MAX - phase)) /
+           CHESS_EVAL_PHASE_MAX;
+}
+
+bool ChessEval_IsDeadDraw(const ChessGame *game) {
+    ChessBitboard occupied = game->occupancy[CHESS_PLAYER_COLOR_BLACK] |
+                             game->occupancy[CHESS_PLAYER_COLOR_WHITE];
+    if (ChessBitboard_Count(occupied) > 3) return false;
+    while (occupied) {
+        int square = ChessBitboard_PopSquare(&occupied);
+        switch (getPieceType(CHESS_BOARD_AT(game, CHESS_SQUARE_X(square), CHESS_SQUARE_Y(square)))) {
+            case PIECE_TYPE_ROOK:
+            case PIECE_TYPE_QUEEN:
+                return false;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+/**
+ * Add the material & piece-square terms of a given game to an evaluation.
+ * Only used for traces, as ChessGame keeps their sum up to date.
+ * @param   game        the game to evaluate
+ * @param   context     the evaluation to add the terms to
+ */
+void evalMaterial(const ChessGame *game, EvalContext *context) {
+    const Weights *named = &weights.named;
+    for (int color = CHESS_PLAYER_COLOR_BLACK; color <= CHESS_PLAYER_COLOR_WHITE; color++) {
+        int sign = color == CHESS_PLAYER_COLOR_WHITE ? 1 : -1;
+        ChessBitboard pieces = game->occupancy[color];
+        while (pieces) {
+            int square = ChessBitboard_PopSquare(&pieces);
+            int x = CHESS_SQUARE_X(square), y = CHESS_SQUARE_Y(square);
+            ChessPiece piece = CHESS_BOARD_AT(game, x, y);
+            PieceType type = getPieceType(piece);
+            int index = getTableIndex(piece, x, y);
+            addTerms(context, &named->midgameValues[type], &named->endgameValues[type], sign);
+            addTerms(context, &named->midgameTables[type][index],
+                     &named->endgameTables[type][index], sign);
+        }
+    }
+}
+
+/**
+ * Add the pawn structure terms of a given player to an evaluation.
+ * @param   game        the game to evaluate
+ * @param   color       the player to evaluate
+ * @param   context     the evaluation to add the terms to
+ */
+void evalPlayerPawns(const ChessGame *game, ChessColor color, EvalContext *context) {
+    const Weights *named = &weights.named;
+    ChessPiece pawn = color == CHESS_PLAYER_COLOR_WHITE
+        ? CHESS_PIECE_WHITE_PAWN
+        : CHESS_PIECE_BLACK_PAWN;
+    ChessPiece opponentPawn = color == CHESS_PLAYER_COLOR_WHITE
+        ? CHESS_PIECE_BLACK_PAWN
+        : CHESS_PIECE_WHITE_PAWN;
+    ChessPiece king = color == CHESS_PLAYER_COLOR_WHITE
+        ? CHESS_PIECE_WHITE_KING
+        : CHESS_PIECE_BLACK_KING;
+    int direction = color == CHESS_PLAYER_COLOR_WHITE ? 1 : -1;
+    int sign = direction;
+    int fileCount[CHESS_GRID] = { 0 };
+    int kingX = -1, kingY = -1;
+    for (int i = 0; i < CHESS_GRID; i++) {
+        for (int j = 0; j < CHESS_GRID; j++) {
+            if (CHESS_BOARD_AT(game, i, j) == pawn) fileCount[i]++;
+            if (CHESS_BOARD_AT(game, i, j) == king) {
+                kingX = i;
+                kingY = j;
+            }
+        }
+    }
+    for (int i = 0; i < CHESS_GRID; i++) {
+        if (!fileCount[i]) continue;
+        if (fileCount[i] > 1) {
+            addTerms(context, &named->doubledMidgame, &named->doubledEndgame,
+                     sign * (fileCount[i] - 1));
+        }
+        bool hasNeighbours = (i > 0 && fileCount[i - 1]) ||
+                             (i < CHESS_GRID - 1 && fileCount[i + 1]);
+        if (!hasNeighbours) {
+            addTerms(context, &named->isolatedMidgame, &named->isolatedEndgame,
+                     sign * fileCount[i]);
+        }
+        for (int j = 0; j < CHESS_GRID; j++) {
+            if (CHESS_BOARD_AT(game, i, j) != pawn) continue;
+            bool isPassed = true;
+            for (int k = i - 1; k <= i + 1 && isPassed; k++) {
+                if (k < 0 || k >= CHESS_GRID) continue;
+                for (int l = j + direction; l >= 0 && l < CHESS_GRID; l += direction) {
+                    if (CHESS_BOARD_AT(game, k, l) == opponentPawn) {
+                        isPassed = false;
+                        break;
+                    }
+                }
+            }
+            if (!isPassed) continue;
+            int rank = color == CHESS_PLAYER_COLOR_WHITE ? j : CHESS_GRID - 1 - j;
+            addTerms(context, &named->passedMidgame[rank], &named->passedEndgame[rank], sign);
+        }
+    }
+    if (kingX < 0) return;
+    for (int i = kingX - 1; i <= kingX + 1; i++) {
+        if (i < 0 || i >= CHESS_GRID) continue;
+        int nearY = kingY + direction, farY = kingY + 2 * direction;
+        if (nearY >= 0 && nearY < CHESS_GRID && CHESS_BOARD_AT(game, i, nearY) == pawn) {
+            addTerm(context, &named->shieldNear, sign, false);
+        } else if (farY >= 0 && farY < CHESS_GRID && CHESS_BOARD_AT(game, i, farY) == pawn) {
+            addTerm(context, &named->shieldFar, sign, false);
+        } else {
+            addTerm(context, &named->shieldMissing, sign, false);
+        }
+    }
+}
+
+void ChessEval_GetPawnScore(const ChessGame *game, int *midgameScore, int *endgameScore,
+                            ChessEvalStats *stats) {
+    *midgameScore = *endgameScore = 0;
+    if (!game) return;
+    CacheEntry *entry = &pawnTable[game->pawnHash & (PAWN_TABLE_SIZE - 1)];
+    uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    uint64_t check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+    if (stats) stats->pawnProbes++;
+    if ((check ^ data) == game->pawnHash) {
+        if (stats) stats->pawnHits++;
+        *midgameScore = (int32_t)(uint32_t)data;
+        *endgameScore = (int32_t)(uint32_t)(data >> 32);
+        return;
+    }
+    EvalContext context = { .midgame = 0, .endgame = 0, .trace = NULL };
+    evalPlayerPawns(game, CHESS_PLAYER_COLOR_WHITE, &context);
+    evalPlayerPawns(game, CHESS_PLAYER_COLOR_BLACK, &context);
+    *midgameScore = context.midgame;
+    *endgameScore = context.endgame;
+    data = (uint64_t)(uint32_t)*midgameScore | (uint64_t)(uint32_t)*endgameScore << 32;
+    __atomic_store_n(&entry->check, game->pawnHash ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+}
+
+/**
+ * Add the mobility & king safety terms of a given game to an evaluation,
+ * from the attack sets of its pieces.
+ * Mobility counts the squares each minor & major piece attacks that aren't
+ * occupied by a friendly piece or attacked by an opponent pawn.
+ * King safety rewards two or more pieces attacking the opponent king's zone.
+ * @param   game        the game to evaluate
+ * @param   context     the evaluation to add the terms to
+ */
+void evalActivity(const ChessGame *game, EvalContext *context) {
+    const Weights *named = &weights.named;
+    ChessBitboard occupied = game->occupancy[CHESS_PLAYER_COLOR_BLACK] |
+                             game->occupancy[CHESS_PLAYER_COLOR_WHITE];
+    ChessBitboard pawns[2] = { 0, 0 };
+    ChessBitboard kingZones[2] = { 0, 0 };
+    for (int color = CHESS_PLAYER_COLOR_BLACK; color <= CHESS_PLAYER_COLOR_WHITE; color++) {
+        ChessBitboard pieces = game->occupancy[color];
+        while (pieces) {
+            int square = ChessBitboard_PopSquare(&pieces);
+            ChessPiece piece = CHESS_BOARD_AT(game, CHESS_SQUARE_X(square), CHESS_SQUARE_Y(square));
+            PieceType type = getPieceType(piece);
+            if (type == PIECE_TYPE_PAWN) pawns[color] |= CHESS_BITBOARD(square);
+            if (type == PIECE_TYPE_KING) {
+                kingZones[color] = CHESS_BITBOARD(square) |
+                                   ChessBitboard_GetAttacks(piece, square, occupied);
+            }
+        }
+    }
+    for (int color = CHESS_PLAYER_COLOR_BLACK; color <= CHESS_PLAYER_COLOR_WHITE; color++) {
+        int opponent = !color, sign = color == CHESS_PLAYER_COLOR_WHITE ? 1 : -1;
+        ChessBitboard safe = ~game->occupancy[color] &
+                             ~ChessBitboard_GetPawnsAttacks(pawns[opponent], opponent);
+        ChessBitboard pieces = game->occupancy[color] & ~pawns[color];
+        int attackers = 0, attackUnits = 0;
+        while (pieces) {
+            int square = ChessBitboard_PopSquare(&pieces);
+            ChessPiece piece = CHESS_BOARD_AT(game, CHESS_SQUARE_X(square), CHESS_SQUARE_Y(square));
+            PieceType type = getPieceType(piece);
+            if (type == PIECE_TYPE_KING) continue;
+            ChessBitboard attacks = ChessBitboard_GetAttacks(piece, square, occupied);
+            int mobility = ChessBitboard_Count(attacks & safe) - mobilityBase[type];
+            addTerms(context, &named->mobilityMidgame[type], &named->mobilityEndgame[type],
+                     sign * mobility);
+            int zoneAttacks = ChessBitboard_Count(attacks & kingZones[opponent]);
+            if (zoneAttacks) {
+                attackers++;
+                attackUnits += kingAttackUnits[type] * zoneAttacks;
+            }
+        }
+        if (attackers < 2) continue; // a lone attacker can't do much
+        if (attackUnits >= SAFETY_TABLE_SIZE) attackUnits = SAFETY_TABLE_SIZE - 1;
+        addTerm(context, &named->safetyTable[attackUnits], sign, false);
+    }
+}
+
+int ChessEval_Evaluate(const ChessGame *game) {
+    bool isExact;
+    return ChessEval_EvaluateLazy(game, INT_MIN, INT_MAX, &isExact, NULL);
+}
+
+int ChessEval_EvaluateLazy(const ChessGame *game, int alpha, int beta, bool *isExact,
+                           ChessEvalStats *stats) {
+    *isExact = true;
+    if (!game) return 0;
+    // stage 1: material + piece-square scores, kept up to date by ChessGame
+    EvalContext context = {
+        .midgame = game->midgameScore,
+        .endgame = game->endgameScore,
+        .trace = NULL,
+    };
+    int score = ChessEval_Taper(context.midgame, context.endgame, game->phase);
+    if (score + CHESS_EVAL_LAZY_MARGIN <= alpha || score - CHESS_EVAL_LAZY_MARGIN >= beta) {
+        if (stats) stats->lazyExits++;
+        *isExact = false;
+        return score;
+    }
+    // stage 2: pawn structure, mostly from the pawn hash
+    int pawnMidgameScore, pawnEndgameScore;
+    ChessEval_GetPawnScore(game, &pawnMidgameScore, &pawnEndgameScore, stats);
+    context.midgame += pawnMidgameScore;
+    context.endgame += pawnEndgameScore;
+    // stage 3: mobility & king safety, from the pieces' attack sets
+    evalActivity(game, &context);
+    return ChessEval_Taper(context.midgame, context.endgame, game->phase);
+}
+
+int ChessEval_Trace(const ChessGame *game, ChessEvalTrace *trace) {
+    if (!game || !trace) return 0;
+    trace->phase = game->phase;
+    trace->size = 0;
+    EvalContext context = { .midgame = 0, .endgame = 0, .trace = trace };
+    evalMaterial(game, &context);
+    evalPlayerPawns(game, CHESS_PLAYER_COLOR_WHITE, &context);
+    evalPlayerPawns(game, CHESS_PLAYER_COLOR_BLACK, &context);
+    evalActivity(game, &context);
+    return ChessEval_Taper(context.midgame, context.endgame, game->phase);
+}
+
+int ChessEval_GetWeight(int index) {
+    if (index < 0 || index >= CHESS_EVAL_WEIGHTS) return 0;
+    return weights.values[index];
+}
+
+void ChessEval_SetWeight(int index, int value) {
+    if (index < 0 || index >= CHESS_EVAL_WEIGHTS) return;
+    weights.values[index] = value;
+}
+
+bool ChessEval_LoadWeights(const char *path) {
+    if (!path) return false;
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+    int values[CHESS_EVAL_WEIGHTS];
+    int count = 0, c;
+    bool isValid = true;
+    while (isValid && (c = fgetc(file)) != EOF) {
+        if (c == '#') { // comments run to the end of the line
+            while ((c = fgetc(file)) != EOF && c != '\n');
+        } else if (!isspace(c)) {
+            ungetc(c, file);
+            isValid = count < CHESS_EVAL_WEIGHTS && fscanf(file, "%d", &values[count++]) == 1;
+        }
+    }
+    fclose(file);
+    if (!isValid || count != CHESS_EVAL_WEIGHTS) return false;
+    memcpy(weights.values, values, sizeof(values));
+    memset(pawnTable, 0, sizeof(pawnTable));
+    ChessEval_ClearCache();
+    return true;
+}
+
+bool ChessEval_SaveWeights(const char *path) {
+    if (!path) return false;
+    FILE *file = fopen(path, "w");
+    if (!file) return false;
+    fprintf(file, WEIGHTS_HEADER ", %d values\n", CHESS_EVAL_WEIGHTS);
+    for (int i = 0; i < CHESS_EVAL_WEIGHTS; i++) {
+        fprintf(file, "%d%c", weights.values[i], i % CHESS_GRID == CHESS_GRID - 1 ? '\n' : ' ');
+    }
+    fputc('\n', file);
+    return fclose(file) == 0;
+}
+
+bool ChessEval_ProbeCache(uint64_t hash, int *score, ChessEvalStats *stats) {
+    CacheEntry *entry = &evalCache[hash & (EVAL_CACHE_SIZE - 1)];
+    uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    uint64_t check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+    if (stats) stats->evalProbes++;
+    if ((check ^ data) != hash) return false;
+    if (stats) stats->evalHits++;
+    *score = (int32_t)(uint32_t)data;
+    return true;
+}
+
+void ChessEval_StoreCache(uint64_t hash, int score) {
+    CacheEntry *entry = &evalCache[hash & (EVAL_CACHE_SIZE - 1)];
+    uint64_t data = (uint32_t)score;
+    __atomic_store_n(&entry->check, hash ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+}
+
+void ChessEval_ClearCache() {
+    memset(evalCache, 0, sizeof(evalCache));
+}
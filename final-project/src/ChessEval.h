@@ -0,0 +1,238 @@
+#ifndef CHESS_EVAL_H_
+#define CHESS_EVAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ChessGame.h"
+
+#define CHESS_EVAL_CHECKMATE_SCORE  100000
+#define CHESS_EVAL_PHASE_MAX        24 // all minor & major pieces on board
+#define CHESS_EVAL_LAZY_MARGIN      300 // heuristic, the terms after the material stage may exceed it
+#define CHESS_EVAL_WEIGHTS          835 // number of tunable evaluation parameters
+#define CHESS_EVAL_TRACE_SIZE       384 // more than the terms of any legal position
+
+
+/**
+ * Counters of the caches & lazy exits of the evaluations of a single search,
+ * kept by its caller as searches may run on several threads at once.
+ */
+typedef struct ChessEvalStats {
+    unsigned long pawnProbes;
+    unsigned long pawnHits;
+    unsigned long evalProbes;
+    unsigned long evalHits;
+    unsigned long lazyExits;
+} ChessEvalStats;
+
+/**
+ * A term of the classical evaluation: the index of its weight and the
+ * number of times it applies, negative for black.
+ */
+typedef struct ChessEvalTerm {
+    uint16_t index;
+    int16_t count;
+    bool isEndgame;
+} ChessEvalTerm;
+
+/**
+ * The terms making up the classical evaluation of a position, which is
+ * linear in the weights: tapering the sums of midgame and endgame
+ * weight * count products by phase gives back the evaluation.
+ */
+typedef struct ChessEvalTrace {
+    int phase;
+    int size;
+    ChessEvalTerm terms[CHESS_EVAL_TRACE_SIZE];
+} ChessEvalTrace;
+
+
+/**
+ * Retrieve the material value of a given ChessPiece, in centipawns.
+ * White pieces are scored positively, black pieces negatively.
+ * @param   piece       the piece to score
+ * @return  0           if piece == CHESS_PIECE_NONE
+ *          the piece's material value otherwise
+ */
+int ChessEval_GetPieceScore(ChessPiece piece);
+
+/**
+ * Retrieve the midgame material and piece-square table value of a given
+ * ChessPiece at a given location, in centipawns.
+ * White pieces are scored positively, black pieces negatively.
+ * Boards are scored by summing this value over all of their pieces, which
+ * ChessGame does incrementally on every move.
+ * @param   piece       the piece to score
+ * @param   x           the piece's column
+ * @param   y           the piece's row
+ * @return  0           if piece == CHESS_PIECE_NONE
+ *          the piece's midgame value at (x, y) otherwise
+ */
+int ChessEval_GetMidgameScore(ChessPiece piece, int x, int y);
+
+/**
+ * Retrieve the endgame material and piece-square table value of a given
+ * ChessPiece at a given location, in centipawns.
+ * Same as ChessEval_GetMidgameScore(), with weights rewarding king activity
+ * and advanced pawns.
+ * @param   piece       the piece to score
+ * @param   x           the piece's column
+ * @param   y           the piece's row
+ * @return  0           if piece == CHESS_PIECE_NONE
+ *          the piece's endgame value at (x, y) otherwise
+ */
+int ChessEval_GetEndgameScore(ChessPiece piece, int x, int y);
+
+/**
+ * Retrieve the contribution of a given ChessPiece to the game phase.
+ * The phase of a board is the sum over all of its pieces: it starts at
+ * CHESS_EVAL_PHASE_MAX and decreases towards 0 as pieces are captured.
+ * @param   piece       the piece to retrieve the weight for
+ * @return  the piece's phase weight
+ */
+int ChessEval_GetPhaseWeight(ChessPiece piece);
+
+/**
+ * Blend a midgame and an endgame score according to a given game phase.
+ * @param   midgameScore    the score to use when phase == CHESS_EVAL_PHASE_MAX
+ * @param   endgameScore    the score to use when phase == 0
+ * @param   phase           the game phase, clamped to [0, CHESS_EVAL_PHASE_MAX]
+ * @return  the tapered score
+ */
+int ChessEval_Taper(int midgameScore, int endgameScore, int phase);
+
+/**
+ * Check whether neither player of a given ChessGame has enough material left
+ * to ever checkmate: a bare king against a king with at most a single pawn,
+ * knight or bishop. As pawns don't promote, king & pawn can't mate either,
+ * as the tbgen tool's KPK table - without a single mate in it - shows.
+ * @param   game        the game to check
+ * @return  true        if the position is a dead draw
+ *          false       otherwise
+ */
+bool ChessEval_IsDeadDraw(const ChessGame *game);
+
+/**
+ * Calculate the pawn structure score of a given ChessGame: doubled, isolated
+ * and passed pawns, and the pawn shields in front of the kings.
+ * White is scored positively, black negatively.
+ * Scores are cached in a pawn hash table keyed by game->pawnHash, as pawns
+ * rarely move between sibling search nodes.
+ * @param   game            the game to evaluate
+ * @param   midgameScore    output parameter for the midgame score
+ * @param   endgameScore    output parameter for the endgame score
+ * @param   stats           the counters to update, or NULL
+ */
+void ChessEval_GetPawnScore(const ChessGame *game, int *midgameScore, int *endgameScore,
+                            ChessEvalStats *stats);
+
+/**
+ * Calculate the classical static evaluation of a given ChessGame: its
+ * incrementally kept material + piece-square scores, its pawn structure
+ * score and its pieces' mobility & king safety, tapered by the game phase.
+ * Doesn't check for checkmates or draws.
+ * @param   game        the game to evaluate
+ * @return  0           if game == NULL
+ *          the score in centipawns, from white's point of view, otherwise
+ */
+int ChessEval_Evaluate(const ChessGame *game);
+
+/**
+ * Calculate the classical static evaluation of a given ChessGame in stages,
+ * stopping after the (constant time) material + piece-square stage when its
+ * score is outside of a given (alpha, beta) window by more than
+ * CHESS_EVAL_LAZY_MARGIN, as the other terms are unlikely to bring it back in.
+ * The margin is a heuristic, not a bound: the other terms aren't bounded by it
+ * (passed pawns & king safety alone can exceed it, and tuned weights can be
+ * anything), so a score that stopped early may be off by more than the margin.
+ * @param   game        the game to evaluate
+ * @param   alpha       the window's lower bound, from white's point of view
+ * @param   beta        the window's upper bound, from white's point of view
+ * @param   isExact     output parameter, false if the evaluation stopped early
+ *                      and the score is only good enough to cut off with
+ * @param   stats       the counters to update, or NULL
+ * @return  0           if game == NULL
+ *          the score in centipawns, from white's point of view, otherwise
+ */
+int ChessEval_EvaluateLazy(const ChessGame *game, int alpha, int beta, bool *isExact,
+                           ChessEvalStats *stats);
+
+/**
+ * Calculate the full classical static evaluation of a given ChessGame from
+ * scratch, recording its terms. Used by the offline tuner, which fits the
+ * weights to game results.
+ * Bypasses the pawn hash and doesn't rely on the game's incremental scores.
+ * @param   game        the game to evaluate
+ * @param   trace       output parameter for the evaluation's terms
+ * @return  0           if game == NULL or trace == NULL
+ *          the same score as ChessEval_Evaluate() otherwise
+ */
+int ChessEval_Trace(const ChessGame *game, ChessEvalTrace *trace);
+
+/**
+ * Retrieve a tunable evaluation weight.
+ * @param   index       the weight's index, in [0, CHESS_EVAL_WEIGHTS)
+ * @return  0           if index is out of range
+ *          the weight's value otherwise
+ */
+int ChessEval_GetWeight(int index);
+
+/**
+ * Set a tunable evaluation weight. Games created before the change keep
+ * their material scores until refreshed by ChessGame_RefreshState(), and
+ * the caches aren't cleared.
+ * Does nothing if index is out of range.
+ * @param   index       the weight's index, in [0, CHESS_EVAL_WEIGHTS)
+ * @param   value       the weight's new value
+ */
+void ChessEval_SetWeight(int index, int value);
+
+/**
+ * Load the evaluation weights from a given text file, as written by
+ * ChessEval_SaveWeights(): CHESS_EVAL_WEIGHTS whitespace-separated integers,
+ * where '#' starts a comment running to the end of the line.
+ * Clears the pawn hash & evaluation cache. Must be done before any game is
+ * created, as games keep their material scores incrementally.
+ * @param   path        the weights file path
+ * @return  true        if the weights were loaded
+ *          false       if the file can't be read or has the wrong number of
+ *                      values, in which case the weights don't change
+ */
+bool ChessEval_LoadWeights(const char *path);
+
+/**
+ * Save the evaluation weights to a given text file.
+ * @param   path        the weights file path
+ * @return  true        if the weights were saved
+ *          false       if the file can't be written
+ */
+bool ChessEval_SaveWeights(const char *path);
+
+/**
+ * Look up the static score of a given position in the evaluation cache.
+ * The cache is direct-mapped and lock-free: a racing or colliding store
+ * is detected and reported as a miss.
+ * @param   hash        the position's Zobrist hash
+ * @param   score       output parameter for the cached score,
+ *                      won't change on a miss
+ * @param   stats       the counters to update, or NULL
+ * @return  true        if the position was found
+ *          false       otherwise
+ */
+bool ChessEval_ProbeCache(uint64_t hash, int *score, ChessEvalStats *stats);
+
+/**
+ * Store the static score of a given position in the evaluation cache,
+ * replacing the entry it's mapped to.
+ * @param   hash        the position's Zobrist hash
+ * @param   score       the position's score
+ */
+void ChessEval_StoreCache(uint64_t hash, int score);
+
+/**
+ * Empty the evaluation cache. Should be called whenever the evaluator
+ * changes (e.g. when an NNUE network is loaded).
+ */
+void ChessEval_ClearCache();
+
+
+#endif
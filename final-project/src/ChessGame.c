@@ -1,10 +1,188 @@
+#include <ctype.h>
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "ChessGame.h"
+#include "ChessEval.h"
+#include "ChessBitboard.h"
 
-#define CHESS_HISTORY_SIZE          6
+#define CHESS_HISTORY_CAPACITY      64 // of a new game's history, doubled as needed
+#define CHESS_HISTORY_SPARE         8 // room of a copy's history, so a search's moves don't grow it
 #define CHESS_MAX_POSSIBLE_MOVES    27 // 7 * 3 + 6 for a queen piece
+#define CHESS_PIECE_TYPES           12
+#define CHESS_ZOBRIST_SEED          0x9E3779B97F4A7C15ULL
+
+
+static uint64_t zobristPieces[CHESS_PIECE_TYPES][CHESS_GRID * CHESS_GRID];
+static uint64_t zobristTurn;
+static pthread_once_t zobristKeysOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Generate the next pseudo-random number of a xorshift64* sequence.
+ * @param   state       the generator state, updated in place
+ * @return  the next number in the sequence
+ */
+uint64_t nextRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Fill the Zobrist keys tables. The seed is fixed so that
+ * hashes are reproducible between runs.
+ * Done once, through pthread_once(), as games may be created on any thread.
+ */
+void initZobristKeys() {
+    uint64_t state = CHESS_ZOBRIST_SEED;
+    for (int i = 0; i < CHESS_PIECE_TYPES; i++) {
+        for (int j = 0; j < CHESS_GRID * CHESS_GRID; j++) {
+            zobristPieces[i][j] = nextRandom(&state);
+        }
+    }
+    zobristTurn = nextRandom(&state);
+}
+
+/**
+ * Retrieve the index of a given ChessPiece in the Zobrist keys table.
+ * @param   piece       the piece to retrieve the index for
+ * @return  -1          if piece == CHESS_PIECE_NONE
+ *          the piece index otherwise
+ */
+int getPieceIndex(ChessPiece piece) {
+    switch (piece) {
+        case CHESS_PIECE_WHITE_PAWN:    return 0;
+        case CHESS_PIECE_WHITE_ROOK:    return 1;
+        case CHESS_PIECE_WHITE_KNIGHT:  return 2;
+        case CHESS_PIECE_WHITE_BISHOP:  return 3;
+        case CHESS_PIECE_WHITE_QUEEN:   return 4;
+        case CHESS_PIECE_WHITE_KING:    return 5;
+        case CHESS_PIECE_BLACK_PAWN:    return 6;
+        case CHESS_PIECE_BLACK_ROOK:    return 7;
+        case CHESS_PIECE_BLACK_KNIGHT:  return 8;
+        case CHESS_PIECE_BLACK_BISHOP:  return 9;
+        case CHESS_PIECE_BLACK_QUEEN:   return 10;
+        case CHESS_PIECE_BLACK_KING:    return 11;
+        case CHESS_PIECE_NONE:
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Retrieve the Zobrist key of a given ChessPiece at a given location.
+ * @return  0           if piece == CHESS_PIECE_NONE
+ *          the piece's key otherwise
+ */
+uint64_t getPieceKey(ChessPiece piece, int x, int y) {
+    int index = getPieceIndex(piece);
+    if (index < 0) return 0;
+    return zobristPieces[index][y * CHESS_GRID + x];
+}
+
+/**
+ * Update the NNUE accumulator of a given game for a given (already done) move.
+ * Does nothing if no network is loaded.
+ * @param   game        the game to update it's accumulator
+ * @param   move        the move, with it's capturedPiece set
+ * @param   piece       the moving piece
+ * @param   isUndo      true when undoing the move
+ */
+void updateMoveAccumulator(ChessGame *game, const ChessMove *move, ChessPiece piece, bool isUndo) {
+    if (!ChessNnue_IsLoaded()) return;
+    int pieceIndex = getPieceIndex(piece);
+    int capturedIndex = getPieceIndex(move->capturedPiece);
+    int from = move->from.y * CHESS_GRID + move->from.x;
+    int to = move->to.y * CHESS_GRID + move->to.x;
+    if (isUndo) {
+        ChessNnue_RemoveFeature(&game->accumulator, pieceIndex, to);
+        ChessNnue_AddFeature(&game->accumulator, pieceIndex, from);
+        if (capturedIndex >= 0) ChessNnue_AddFeature(&game->accumulator, capturedIndex, to);
+    } else {
+        if (capturedIndex >= 0) ChessNnue_RemoveFeature(&game->accumulator, capturedIndex, to);
+        ChessNnue_RemoveFeature(&game->accumulator, pieceIndex, from);
+        ChessNnue_AddFeature(&game->accumulator, pieceIndex, to);
+    }
+}
+
+bool isPawn(ChessPiece piece) {
+    return piece == CHESS_PIECE_WHITE_PAWN || piece == CHESS_PIECE_BLACK_PAWN;
+}
+
+/**
+ * Check whether a given ChessPiece is part of the pawn hash.
+ * Kings are included as the pawn shields in front of them are cached too.
+ * @param   piece       the piece to check
+ * @return  true        if piece is a pawn or a king
+ *          false       otherwise
+ */
+bool isPawnKeyPiece(ChessPiece piece) {
+    return isPawn(piece) ||
+           piece == CHESS_PIECE_WHITE_KING || piece == CHESS_PIECE_BLACK_KING;
+}
+
+/**
+ * Toggle the Zobrist keys a given (already done) move changes.
+ * Applying it twice restores the original hash.
+ * @param   game        the game to update it's hash
+ * @param   move        the move, with it's capturedPiece set
+ * @param   piece       the moving piece
+ */
+void toggleMoveKeys(ChessGame *game, const ChessMove *move, ChessPiece piece) {
+    game->hash ^= getPieceKey(piece, move->from.x, move->from.y);
+    game->hash ^= getPieceKey(piece, move->to.x, move->to.y);
+    game->hash ^= getPieceKey(move->capturedPiece, move->to.x, move->to.y);
+    game->hash ^= zobristTurn;
+    if (isPawnKeyPiece(piece)) {
+        game->pawnHash ^= getPieceKey(piece, move->from.x, move->from.y);
+        game->pawnHash ^= getPieceKey(piece, move->to.x, move->to.y);
+    }
+    if (isPawnKeyPiece(move->capturedPiece)) {
+        game->pawnHash ^= getPieceKey(move->capturedPiece, move->to.x, move->to.y);
+    }
+}
+
+/**
+ * Apply the material + piece-square score and phase deltas
+ * of a given (already done) move.
+ * @param   game        the game to update it's score
+ * @param   move        the move, with it's capturedPiece set
+ * @param   piece       the moving piece
+ * @param   sign        1 when doing the move, -1 when undoing it
+ */
+void updateMoveScore(ChessGame *game, const ChessMove *move, ChessPiece piece, int sign) {
+    ChessPos from = move->from, to = move->to;
+    ChessPiece captured = move->capturedPiece;
+    game->midgameScore += sign * (ChessEval_GetMidgameScore(piece, to.x, to.y) -
+                                  ChessEval_GetMidgameScore(piece, from.x, from.y) -
+                                  ChessEval_GetMidgameScore(captured, to.x, to.y));
+    game->endgameScore += sign * (ChessEval_GetEndgameScore(piece, to.x, to.y) -
+                                  ChessEval_GetEndgameScore(piece, from.x, from.y) -
+                                  ChessEval_GetEndgameScore(captured, to.x, to.y));
+    game->phase -= sign * ChessEval_GetPhaseWeight(captured);
+}
+
+/**
+ * Toggle the occupancy bitboards' squares a given (already done) move changes.
+ * Applying it twice restores the original bitboards.
+ * @param   game        the game to update it's bitboards
+ * @param   move        the move, with it's capturedPiece and player set
+ */
+void toggleMoveOccupancy(ChessGame *game, const ChessMove *move) {
+    int from = CHESS_SQUARE(move->from.x, move->from.y);
+    int to = CHESS_SQUARE(move->to.x, move->to.y);
+    game->occupancy[move->player] ^= CHESS_BITBOARD(from) | CHESS_BITBOARD(to);
+    if (move->capturedPiece != CHESS_PIECE_NONE) {
+        ChessColor opponent = move->player == CHESS_PLAYER_COLOR_WHITE
+            ? CHESS_PLAYER_COLOR_BLACK
+            : CHESS_PLAYER_COLOR_WHITE;
+        game->occupancy[opponent] ^= CHESS_BITBOARD(to);
+    }
+}
+
 
 
 /**
@@ -14,7 +192,7 @@
  *          false       otherwise
  */
 bool isValidPositionOnBoard(ChessPos pos) {
-    return pos.x >= 0 && pos.x < CHESS_GRID && pos.y >= 0 && pos.y < CHESS_GRID;
+    return !((pos.x | pos.y) & ~(CHESS_GRID - 1)); // negative ones set the high bits
 }
 
 /**
@@ -62,7 +240,7 @@ ChessColor getPieceColor(ChessPiece piece) {
  */
 bool isPosOfPlayerPiece(ChessGame *game, ChessPos pos) {
     if (!game) return false; // sanity check
-    return getPieceColor(game->board[pos.x][pos.y]) == game->turn;
+    return getPieceColor(CHESS_BOARD_AT(game, pos.x, pos.y)) == game->turn;
 }
 
 /**
@@ -75,42 +253,48 @@ bool isPosOfPlayerPiece(ChessGame *game, ChessPos pos) {
  */
 bool isValidToPosition(ChessGame *game, ChessMove move) {
     if (!game) return false; // sanity check
-    ChessColor fromColor = getPieceColor(game->board[move.from.x][move.from.y]);
-    ChessColor toColor = getPieceColor(game->board[move.to.x][move.to.y]);
+    ChessColor fromColor = getPieceColor(CHESS_BOARD_AT(game, move.from.x, move.from.y));
+    ChessColor toColor = getPieceColor(CHESS_BOARD_AT(game, move.to.x, move.to.y));
     return fromColor != toColor;
 }
 
 bool isValidPawnMove(ChessGame *game, ChessMove move) {
-    ChessColor color = getPieceColor(game->board[move.from.x][move.from.y]);
+    ChessColor color = getPieceColor(CHESS_BOARD_AT(game, move.from.x, move.from.y));
     int isInStartPos = move.from.y == (color == CHESS_PLAYER_COLOR_WHITE ? 1 : 6);
     int horDiff = abs(move.from.x - move.to.x);
     int verDiff = (move.from.y - move.to.y) * (color == CHESS_PLAYER_COLOR_WHITE ? -1 : 1);
-    int isCapture = game->board[move.to.x][move.to.y] != CHESS_PIECE_NONE &&
-        color != getPieceColor(game->board[move.to.x][move.to.y]);
+    int isCapture = CHESS_BOARD_AT(game, move.to.x, move.to.y) != CHESS_PIECE_NONE &&
+        color != getPieceColor(CHESS_BOARD_AT(game, move.to.x, move.to.y));
     int regularMove = !isCapture && verDiff == 1 && horDiff == 0;
     int startingMove = !isCapture && isInStartPos && verDiff == 2 && horDiff == 0;
     int capturingMove = isCapture && verDiff == 1 && horDiff == 1;
     return regularMove || startingMove || capturingMove;
 }
 
+/**
+ * Check whether the squares between a given ChessMove's locations are empty,
+ * for a move along a row, a column or a diagonal.
+ * @param   game        the game instance which provides the board
+ * @param   move        the move to check
+ * @return  true        if no piece is in the way
+ *          false       otherwise
+ */
+bool isPathClear(ChessGame *game, ChessMove move) {
+    int horStep = (move.to.x > move.from.x) - (move.to.x < move.from.x);
+    int verStep = (move.to.y > move.from.y) - (move.to.y < move.from.y);
+    int step = CHESS_BOARD_SQUARE(horStep, verStep);
+    int to = CHESS_BOARD_SQUARE(move.to.x, move.to.y);
+    for (int i = CHESS_BOARD_SQUARE(move.from.x, move.from.y) + step; i != to; i += step) {
+        if (game->board[i] != CHESS_PIECE_NONE) return false;
+    }
+    return true;
+}
+
 bool isValidRookMove(ChessGame *game, ChessMove move) {
     int horDiff = move.from.x - move.to.x;
     int verDiff = move.from.y - move.to.y;
     if (!((horDiff != 0) ^ (verDiff != 0))) return false; // exclusive ver / hor move
-    if (horDiff != 0) { // check there isn't overleap
-        int start = move.from.x < move.to.x ? move.from.x + 1 : move.to.x + 1;
-        int end = move.from.x < move.to.x ? move.to.x : move.from.x;
-        for (int i = start; i < end; i++) {
-            if (game->board[i][move.from.y] != CHESS_PIECE_NONE) return false;
-        }
-    } else { // verDiff != 0
-        int start = move.from.y < move.to.y ? move.from.y + 1 : move.to.y + 1;
-        int end = move.from.y < move.to.y ? move.to.y : move.from.y;
-        for (int i = start; i < end; i++) {
-            if (game->board[move.from.x][i] != CHESS_PIECE_NONE) return false;
-        }
-    }
-    return true;
+    return isPathClear(game, move);
 }
 
 bool isValidKnightMove(ChessGame *game, ChessMove move) {
@@ -124,34 +308,7 @@ bool isValidBishopMove(ChessGame *game, ChessMove move) {
     int horAbs = abs(move.from.x - move.to.x);
     int verAbs = abs(move.from.y - move.to.y);
     if (horAbs != verAbs || !horAbs) return false;
-    if (horAbs == 1 && getPieceColor(game->board[move.to.x][move.to.y]) != game->turn) {
-        return true;
-    }
-    bool rightup   = (move.from.x < move.to.x) && (move.from.y < move.to.y);
-    bool leftup    = (move.from.x > move.to.x) && (move.from.y < move.to.y);
-    bool rightdown = (move.from.x < move.to.x) && (move.from.y > move.to.y);
-    bool leftdown  = (move.from.x > move.to.x) && (move.from.y > move.to.y);
-    int startx, starty, endx;
-    if (rightup || rightdown){
-        startx = move.from.x + 1;
-        endx = move.to.x;
-        if (rightup) starty = move.from.y + 1;
-        else starty = move.from.y - 1;
-    } else {
-        startx = move.to.x + 1;
-        endx = move.from.x;
-        if (leftup) starty = move.to.y - 1;
-        else starty = move.to.y + 1;
-    }
-
-    for (int i = startx, j = starty; i < endx;){
-        if (game->board[i][j] != CHESS_PIECE_NONE) return false;
-        if (rightup){i++; j++;}
-        if (leftup){i++; j--;}
-        if (rightdown){i++; j--;}
-        if (leftdown){i++; j++;}
-    }
-    return true;
+    return isPathClear(game, move);
 }
 
 bool isValidQueenMove(ChessGame *game, ChessMove move) {
@@ -167,7 +324,7 @@ bool isValidKingMove(ChessGame *game, ChessMove move) {
 
 bool isValidPieceMove(ChessGame *game, ChessMove move) {
     if (!game) return false;
-    switch (game->board[move.from.x][move.from.y])
+    switch (CHESS_BOARD_AT(game, move.from.x, move.from.y))
     {
         case CHESS_PIECE_WHITE_PAWN:
         case CHESS_PIECE_BLACK_PAWN:
@@ -208,7 +365,7 @@ bool isPosThreatenedBy(ChessGame *game, ChessPos pos, ChessColor playerColor) {
     ChessMove move = { .to = pos };
     for (int i = 0; i < CHESS_GRID; i++) {
         for (int j = 0; j < CHESS_GRID; j++) {
-            if (getPieceColor(game->board[i][j]) == playerColor) {
+            if (getPieceColor(CHESS_BOARD_AT(game, i, j)) == playerColor) {
                 move.from = (ChessPos){ .x = i, .y = j };
                 if (isValidPieceMove(game, move)) return true;
             }
@@ -224,7 +381,7 @@ bool isKingThreatenedBy(ChessGame *game, ChessColor playerColor) {
     ChessPos opponentKingPos;
     for (int i = 0 ; i < CHESS_GRID; i++) {
         for (int j = 0; j < CHESS_GRID; j++) {
-            if (game->board[i][j] == king) {
+            if (CHESS_BOARD_AT(game, i, j) == king) {
                 opponentKingPos.x = i;
                 opponentKingPos.y = j;
             }
@@ -235,39 +392,21 @@ bool isKingThreatenedBy(ChessGame *game, ChessColor playerColor) {
 
 void pseudoDoMove(ChessGame *game, ChessMove *move) {
     move->player = game->turn;
-    move->capturedPiece = game->board[move->to.x][move->to.y];
-    game->board[move->to.x][move->to.y] = game->board[move->from.x][move->from.y];
-    game->board[move->from.x][move->from.y] = CHESS_PIECE_NONE;
+    move->capturedPiece = CHESS_BOARD_AT(game, move->to.x, move->to.y);
+    CHESS_BOARD_AT(game, move->to.x, move->to.y) = CHESS_BOARD_AT(game, move->from.x, move->from.y);
+    CHESS_BOARD_AT(game, move->from.x, move->from.y) = CHESS_PIECE_NONE;
 }
 
 void pseudoUndoMove(ChessGame *game, ChessMove *move) {
-    game->board[move->from.x][move->from.y] = game->board[move->to.x][move->to.y];
-    game->board[move->to.x][move->to.y] = move->capturedPiece; 
-}
-
-bool hasMoves(ChessGame *game) {
-    ArrayStack *possibleMoves = NULL;
-    ChessPos pos;
-    ChessColor color;
-    for (int i = 0; i < CHESS_GRID; i ++) {
-        for (int j = 0; j < CHESS_GRID; j++) {
-            ChessGame_GetPieceColor(game->board[i][j], &color);
-            if (color != game->turn) continue;
-            pos = (ChessPos){ .x = i, .y = j };
-            ChessResult res = ChessGame_GetMoves(game, pos, &possibleMoves);
-            bool areThereMoves = !ArrayStack_IsEmpty(possibleMoves);
-            ArrayStack_Destroy(possibleMoves);
-            if (res != CHESS_SUCCESS || areThereMoves) return true;
-        }
-    }
-    return false;
+    CHESS_BOARD_AT(game, move->from.x, move->from.y) = CHESS_BOARD_AT(game, move->to.x, move->to.y);
+    CHESS_BOARD_AT(game, move->to.x, move->to.y) = move->capturedPiece; 
 }
 
 ChessPosType getMoveType(ChessGame *game, ChessMove move) {
     pseudoDoMove(game, &move);
     bool isThreatened = isPosThreatenedBy(game, move.to, !game->turn);
     pseudoUndoMove(game, &move);
-    bool isCapture = game->board[move.to.x][move.to.y] != CHESS_PIECE_NONE;
+    bool isCapture = CHESS_BOARD_AT(game, move.to.x, move.to.y) != CHESS_PIECE_NONE;
     if (isThreatened && isCapture) return CHESS_POS_BOTH;
     if (isThreatened) return CHESS_POS_THREATENED;
     if (isCapture) return CHESS_POS_CAPTURE;
@@ -305,13 +444,82 @@ ChessResult isValidMove(ChessGame *game, ChessMove move) {
     return CHESS_SUCCESS;
 }
 
+bool hasMoves(ChessGame *game) {
+    ChessMove move;
+    for (int i = 0; i < CHESS_GRID; i ++) {
+        for (int j = 0; j < CHESS_GRID; j++) {
+            if (getPieceColor(CHESS_BOARD_AT(game, i, j)) != game->turn) continue;
+            move.from = (ChessPos){ .x = i, .y = j };
+            for (int k = 0; k < CHESS_GRID; k++) {
+                for (int l = 0; l < CHESS_GRID; l++) {
+                    move.to = (ChessPos){ .x = k, .y = l };
+                    if (isValidMove(game, move) == CHESS_SUCCESS) return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Make room for one more move in a given ChessGame's history.
+ * @param   history     the history to grow
+ * @return  true        if there's room
+ *          false       if realloc failed
+ */
+bool reserveHistory(ChessHistory *history) {
+    if (history->size < history->capacity) return true;
+    unsigned int capacity = history->capacity ? history->capacity * 2 : CHESS_HISTORY_CAPACITY;
+    ChessHistoryEntry *entries = realloc(history->entries, capacity * sizeof(ChessHistoryEntry));
+    if (!entries) return false;
+    history->entries = entries;
+    history->capacity = capacity;
+    return true;
+}
+
+/**
+ * Unpack a given move of a given ChessGame's history, done or undone.
+ * @param   game        the game
+ * @param   index       the move's index, below the history's length
+ * @return  the move, with its player, captured piece and halfmove clock set
+ */
+ChessMove getHistoryMove(const ChessGame *game, unsigned int index) {
+    const ChessHistoryEntry *entry = &game->history.entries[index];
+    bool isOpponentMove = (game->history.size - index) % 2; // the players alternate
+    ChessMove move = ChessGame_UnpackMove(entry->move);
+    move.capturedPiece = entry->capturedPiece;
+    move.player = isOpponentMove ? switchColor(game->turn) : game->turn;
+    move.halfmoveClock = entry->halfmoveClock;
+    return move;
+}
+
+ChessPackedMove ChessGame_PackMove(ChessMove move) {
+    return CHESS_MOVE_PACK(CHESS_SQUARE(move.from.x, move.from.y),
+                           CHESS_SQUARE(move.to.x, move.to.y), 0);
+}
+
+ChessMove ChessGame_UnpackMove(ChessPackedMove move) {
+    int from = CHESS_MOVE_FROM(move), to = CHESS_MOVE_TO(move);
+    return (ChessMove){
+        .from = { .x = CHESS_SQUARE_X(from), .y = CHESS_SQUARE_Y(from) },
+        .to = { .x = CHESS_SQUARE_X(to), .y = CHESS_SQUARE_Y(to) },
+        .capturedPiece = CHESS_PIECE_NONE,
+    };
+}
+
 ChessGame* ChessGame_Create() {
+    pthread_once(&zobristKeysOnce, initZobristKeys);
     ChessGame *game = malloc(sizeof(ChessGame));
     if (!game) return ChessGame_Destroy(game);
+    game->history = (ChessHistory){ .entries = NULL, .size = 0, .length = 0, .capacity = 0 };
     game->turn = CHESS_PLAYER_COLOR_WHITE;
     ChessGame_SetDefaultSettings(game);
-    game->history = ArrayStack_Create(CHESS_HISTORY_SIZE, sizeof(ChessMove));
-    if (!game->history) ChessGame_Destroy(game);
+    game->hash = game->pawnHash = 0;
+    game->midgameScore = game->endgameScore = game->phase = 0;
+    game->occupancy[CHESS_PLAYER_COLOR_BLACK] = game->occupancy[CHESS_PLAYER_COLOR_WHITE] = 0;
+    game->halfmoveClock = 0;
+    game->fullmoveNumber = 1;
+    if (!reserveHistory(&game->history)) return ChessGame_Destroy(game);
     return game;
 }
 
@@ -319,14 +527,18 @@ ChessGame* ChessGame_Copy(const ChessGame *game) {
     ChessGame *copy = malloc(sizeof(ChessGame));
     if (!copy) return NULL;
     memcpy(copy, game, sizeof(ChessGame));
-    copy->history = ArrayStack_Copy(game->history);
-    if (!copy->history) ChessGame_Destroy(copy);
+    copy->history.length = copy->history.size;
+    copy->history.capacity = copy->history.size + CHESS_HISTORY_SPARE;
+    copy->history.entries = malloc(copy->history.capacity * sizeof(ChessHistoryEntry));
+    if (!copy->history.entries) return ChessGame_Destroy(copy);
+    memcpy(copy->history.entries, game->history.entries,
+           copy->history.size * sizeof(ChessHistoryEntry));
     return copy;
 }
 
 ChessGame* ChessGame_Destroy(ChessGame *game) {
     if (!game) return NULL;
-    ArrayStack_Destroy(game->history);
+    free(game->history.entries);
     free(game);
     return NULL;
 }
@@ -334,10 +546,10 @@ ChessGame* ChessGame_Destroy(ChessGame *game) {
 ChessResult ChessGame_ResetGame(ChessGame *game) {
     if (!game) return CHESS_INVALID_ARGUMENT;
     game->turn = CHESS_PLAYER_COLOR_WHITE;
+    game->halfmoveClock = 0;
+    game->fullmoveNumber = 1;
     ChessGame_InitBoard(game);
-    ArrayStack_Destroy(game->history);
-    game->history = ArrayStack_Create(CHESS_HISTORY_SIZE, sizeof(ChessMove));
-    return CHESS_SUCCESS;
+    return ChessGame_ClearHistory(game);
 }
 
 ChessResult ChessGame_SetDefaultSettings(ChessGame *game) {
@@ -374,23 +586,47 @@ ChessResult ChessGame_SetUserColor(ChessGame *game, ChessColor userColor) {
 
 ChessResult ChessGame_InitBoard(ChessGame *game) {
     if (!game) return CHESS_INVALID_ARGUMENT;
-    game->board[0][0] = game->board[7][0] = CHESS_PIECE_WHITE_ROOK;
-    game->board[1][0] = game->board[6][0] = CHESS_PIECE_WHITE_KNIGHT;
-    game->board[2][0] = game->board[5][0] = CHESS_PIECE_WHITE_BISHOP;
-    game->board[3][0] = CHESS_PIECE_WHITE_QUEEN;
-    game->board[4][0] = CHESS_PIECE_WHITE_KING;
-    game->board[0][7] = game->board[7][7] = CHESS_PIECE_BLACK_ROOK;
-    game->board[1][7] = game->board[6][7] = CHESS_PIECE_BLACK_KNIGHT;
-    game->board[2][7] = game->board[5][7] = CHESS_PIECE_BLACK_BISHOP;
-    game->board[3][7] = CHESS_PIECE_BLACK_QUEEN;
-    game->board[4][7] = CHESS_PIECE_BLACK_KING;
+    memset(game->board, CHESS_PIECE_NONE, sizeof(game->board));
+    CHESS_BOARD_AT(game, 0, 0) = CHESS_BOARD_AT(game, 7, 0) = CHESS_PIECE_WHITE_ROOK;
+    CHESS_BOARD_AT(game, 1, 0) = CHESS_BOARD_AT(game, 6, 0) = CHESS_PIECE_WHITE_KNIGHT;
+    CHESS_BOARD_AT(game, 2, 0) = CHESS_BOARD_AT(game, 5, 0) = CHESS_PIECE_WHITE_BISHOP;
+    CHESS_BOARD_AT(game, 3, 0) = CHESS_PIECE_WHITE_QUEEN;
+    CHESS_BOARD_AT(game, 4, 0) = CHESS_PIECE_WHITE_KING;
+    CHESS_BOARD_AT(game, 0, 7) = CHESS_BOARD_AT(game, 7, 7) = CHESS_PIECE_BLACK_ROOK;
+    CHESS_BOARD_AT(game, 1, 7) = CHESS_BOARD_AT(game, 6, 7) = CHESS_PIECE_BLACK_KNIGHT;
+    CHESS_BOARD_AT(game, 2, 7) = CHESS_BOARD_AT(game, 5, 7) = CHESS_PIECE_BLACK_BISHOP;
+    CHESS_BOARD_AT(game, 3, 7) = CHESS_PIECE_BLACK_QUEEN;
+    CHESS_BOARD_AT(game, 4, 7) = CHESS_PIECE_BLACK_KING;
     for (int j = 0; j < CHESS_GRID; j++) {
-        game->board[j][1] = CHESS_PIECE_WHITE_PAWN;
-        game->board[j][6] = CHESS_PIECE_BLACK_PAWN;
+        CHESS_BOARD_AT(game, j, 1) = CHESS_PIECE_WHITE_PAWN;
+        CHESS_BOARD_AT(game, j, 6) = CHESS_PIECE_BLACK_PAWN;
     }
-    for (int i = 2; i < CHESS_GRID - 2; i++) {
+    return ChessGame_RefreshState(game);
+}
+
+ChessResult ChessGame_RefreshState(ChessGame *game) {
+    if (!game) return CHESS_INVALID_ARGUMENT;
+    game->hash = game->turn == CHESS_PLAYER_COLOR_BLACK ? zobristTurn : 0;
+    game->pawnHash = 0;
+    game->midgameScore = game->endgameScore = game->phase = 0;
+    game->occupancy[CHESS_PLAYER_COLOR_BLACK] = game->occupancy[CHESS_PLAYER_COLOR_WHITE] = 0;
+    bool isNnueLoaded = ChessNnue_IsLoaded();
+    if (isNnueLoaded) ChessNnue_ResetAccumulator(&game->accumulator);
+    for (int i = 0; i < CHESS_GRID; i++) {
         for (int j = 0; j < CHESS_GRID; j++) {
-            game->board[j][i] = CHESS_PIECE_NONE;
+            ChessPiece piece = CHESS_BOARD_AT(game, i, j);
+            game->hash ^= getPieceKey(piece, i, j);
+            if (isPawnKeyPiece(piece)) game->pawnHash ^= getPieceKey(piece, i, j);
+            game->midgameScore += ChessEval_GetMidgameScore(piece, i, j);
+            game->endgameScore += ChessEval_GetEndgameScore(piece, i, j);
+            game->phase += ChessEval_GetPhaseWeight(piece);
+            ChessColor color = getPieceColor(piece);
+            if (color != CHESS_PLAYER_COLOR_NONE) {
+                game->occupancy[color] |= CHESS_BITBOARD(CHESS_SQUARE(i, j));
+            }
+            if (isNnueLoaded && piece != CHESS_PIECE_NONE) {
+                ChessNnue_AddFeature(&game->accumulator, getPieceIndex(piece), j * CHESS_GRID + i);
+            }
         }
     }
     return CHESS_SUCCESS;
@@ -403,23 +639,78 @@ ChessResult ChessGame_GetGameStatus(ChessGame *game, ChessStatus *status) {
     } else {
         *status = hasMoves(game) ? CHESS_STATUS_RUNNING : CHESS_STATUS_DRAW;
     }
+    if (*status != CHESS_STATUS_CHECKMATE &&
+        game->halfmoveClock >= CHESS_FIFTY_MOVE_LIMIT) {
+        *status = CHESS_STATUS_DRAW;
+    }
     return CHESS_SUCCESS;
 }
 
 ChessResult ChessGame_DoMove(ChessGame *game, ChessMove move) {
     ChessResult isValidResult = isValidMove(game, move);
     if (isValidResult != CHESS_SUCCESS) return isValidResult;
+    if (!reserveHistory(&game->history)) return CHESS_INVALID_ARGUMENT;
+    ChessPiece piece = CHESS_BOARD_AT(game, move.from.x, move.from.y);
+    ChessHistoryEntry *entry = &game->history.entries[game->history.size++];
+    game->history.length = game->history.size;
+    entry->hash = game->hash;
+    entry->halfmoveClock = game->halfmoveClock;
+    entry->move = ChessGame_PackMove(move);
     pseudoDoMove(game, &move);
-    ArrayStack_Push(game->history, &move);
+    entry->capturedPiece = move.capturedPiece;
+    toggleMoveKeys(game, &move, piece);
+    updateMoveScore(game, &move, piece, 1);
+    updateMoveAccumulator(game, &move, piece, false);
+    toggleMoveOccupancy(game, &move);
+    bool isIrreversible = isPawn(piece) || move.capturedPiece != CHESS_PIECE_NONE;
+    game->halfmoveClock = isIrreversible ? 0 : game->halfmoveClock + 1;
+    if (game->turn == CHESS_PLAYER_COLOR_BLACK) game->fullmoveNumber++;
     game->turn = switchColor(game->turn);
     return CHESS_SUCCESS;
 }
 
 ChessResult ChessGame_UndoMove(ChessGame *game, ChessMove *move) {
-    if (ArrayStack_IsEmpty(game->history)) return CHESS_EMPTY_HISTORY;
-    *move = *(ChessMove *)ArrayStack_Pop(game->history);
+    if (!game->history.size) return CHESS_EMPTY_HISTORY;
+    *move = getHistoryMove(game, game->history.size - 1);
+    game->history.size--;
     pseudoUndoMove(game, move);
+    ChessPiece piece = CHESS_BOARD_AT(game, move->from.x, move->from.y);
+    toggleMoveKeys(game, move, piece);
+    updateMoveScore(game, move, piece, -1);
+    updateMoveAccumulator(game, move, piece, true);
+    toggleMoveOccupancy(game, move);
+    game->halfmoveClock = move->halfmoveClock;
     game->turn = switchColor(game->turn);
+    if (game->turn == CHESS_PLAYER_COLOR_BLACK) game->fullmoveNumber--;
+    return CHESS_SUCCESS;
+}
+
+ChessResult ChessGame_RedoMove(ChessGame *game, ChessMove *move) {
+    if (!game || !move) return CHESS_INVALID_ARGUMENT;
+    if (game->history.size == game->history.length) return CHESS_EMPTY_HISTORY;
+    unsigned int length = game->history.length;
+    ChessMove redoneMove = getHistoryMove(game, game->history.size);
+    ChessResult result = ChessGame_DoMove(game, redoneMove);
+    if (result != CHESS_SUCCESS) return result;
+    game->history.length = length; // the moves after it can still be redone
+    *move = redoneMove;
+    return CHESS_SUCCESS;
+}
+
+unsigned int ChessGame_GetHistorySize(const ChessGame *game) {
+    if (!game) return 0;
+    return game->history.size;
+}
+
+ChessResult ChessGame_GetHistoryMove(const ChessGame *game, unsigned int index, ChessMove *move) {
+    if (!game || !move || index >= game->history.size) return CHESS_INVALID_ARGUMENT;
+    *move = getHistoryMove(game, index);
+    return CHESS_SUCCESS;
+}
+
+ChessResult ChessGame_ClearHistory(ChessGame *game) {
+    if (!game) return CHESS_INVALID_ARGUMENT;
+    game->history.size = game->history.length = 0;
     return CHESS_SUCCESS;
 }
 
@@ -427,7 +718,7 @@ ChessResult ChessGame_GetMoves(ChessGame *game, ChessPos pos, ArrayStack **stack
     *stack = ArrayStack_Create(CHESS_MAX_POSSIBLE_MOVES, sizeof(ChessPos));
     if (!game) return CHESS_INVALID_ARGUMENT;
     if (!isValidPositionOnBoard(pos)) return CHESS_INVALID_POSITION;
-    if (game->board[pos.x][pos.y] == CHESS_PIECE_NONE) return CHESS_EMPTY_POSITION;
+    if (CHESS_BOARD_AT(game, pos.x, pos.y) == CHESS_PIECE_NONE) return CHESS_EMPTY_POSITION;
     ChessColor originalTurn = game->turn;
     if (!isPosOfPlayerPiece(game, pos)) {
         game->turn = switchColor(game->turn);
@@ -446,7 +737,314 @@ ChessResult ChessGame_GetMoves(ChessGame *game, ChessPos pos, ArrayStack **stack
     return CHESS_SUCCESS;
 }
 
+unsigned int ChessGame_GetAllMoves(ChessGame *game, ChessPackedMove *moves) {
+    if (!game || !moves) return 0;
+    unsigned int count = 0;
+    ChessMove move;
+    for (int i = 0; i < CHESS_GRID; i++) {
+        for (int j = 0; j < CHESS_GRID; j++) {
+            if (getPieceColor(CHESS_BOARD_AT(game, i, j)) != game->turn) continue;
+            move.from = (ChessPos){ .x = i, .y = j };
+            for (int k = 0; k < CHESS_GRID; k++) {
+                for (int l = 0; l < CHESS_GRID; l++) {
+                    move.to = (ChessPos){ .x = k, .y = l };
+                    if (isValidMove(game, move) != CHESS_SUCCESS) continue;
+                    bool isCapture = CHESS_BOARD_AT(game, k, l) != CHESS_PIECE_NONE;
+                    moves[count++] = CHESS_MOVE_PACK(CHESS_SQUARE(i, j), CHESS_SQUARE(k, l),
+                                                     isCapture ? CHESS_MOVE_FLAG_CAPTURE : 0);
+                }
+            }
+        }
+    }
+    return count;
+}
+
 ChessResult ChessGame_GetPieceColor(ChessPiece piece, ChessColor *color) {
     *color = getPieceColor(piece);
     return CHESS_SUCCESS;
 }
+
+bool ChessGame_IsRepetition(const ChessGame *game) {
+    if (!game) return false;
+    unsigned int size = game->history.size;
+    unsigned int limit = game->halfmoveClock < size ? game->halfmoveClock : size;
+    for (unsigned int i = 4; i <= limit; i += 2) { // same player to move
+        if (game->history.entries[size - i].hash == game->hash) return true;
+    }
+    return false;
+}
+
+/**
+ * Retrieve the ChessPiece of a given FEN piece letter.
+ * @param   c           the letter, uppercase for white pieces
+ * @return  CHESS_PIECE_NONE if c isn't a piece letter
+ *          the letter's piece otherwise
+ */
+ChessPiece getFenPiece(char c) {
+    switch (c) {
+        case 'P': return CHESS_PIECE_WHITE_PAWN;
+        case 'R': return CHESS_PIECE_WHITE_ROOK;
+        case 'N': return CHESS_PIECE_WHITE_KNIGHT;
+        case 'B': return CHESS_PIECE_WHITE_BISHOP;
+        case 'Q': return CHESS_PIECE_WHITE_QUEEN;
+        case 'K': return CHESS_PIECE_WHITE_KING;
+        case 'p': return CHESS_PIECE_BLACK_PAWN;
+        case 'r': return CHESS_PIECE_BLACK_ROOK;
+        case 'n': return CHESS_PIECE_BLACK_KNIGHT;
+        case 'b': return CHESS_PIECE_BLACK_BISHOP;
+        case 'q': return CHESS_PIECE_BLACK_QUEEN;
+        case 'k': return CHESS_PIECE_BLACK_KING;
+        default: return CHESS_PIECE_NONE;
+    }
+}
+
+/**
+ * Skip the whitespace separating two FEN fields.
+ * @param   fen         the FEN string, advanced past the whitespace
+ * @return  true        if there was whitespace to skip
+ *          false       otherwise
+ */
+bool skipFenSeparator(const char **fen) {
+    if (!isspace((unsigned char)**fen)) return false;
+    while (isspace((unsigned char)**fen)) (*fen)++;
+    return true;
+}
+
+/**
+ * Parse the decimal number of a FEN field.
+ * @param   fen         the FEN string, advanced past the number
+ * @param   value       output parameter for the number
+ * @return  true        if a number in [0, 99999] was parsed
+ *          false       otherwise
+ */
+bool parseFenNumber(const char **fen, unsigned int *value) {
+    if (!isdigit((unsigned char)**fen)) return false;
+    *value = 0;
+    for (int digits = 0; isdigit((unsigned char)**fen); digits++, (*fen)++) {
+        if (digits == 5) return false;
+        *value = *value * 10 + (**fen - '0');
+    }
+    return true;
+}
+
+/**
+ * Retrieve the FEN piece letter of a given ChessPiece.
+ * @param   piece       the piece
+ * @return  '?' if piece isn't a piece
+ *          the piece's letter, uppercase for white pieces otherwise
+ */
+char getPieceFenLetter(ChessPiece piece) {
+    switch (piece) {
+        case CHESS_PIECE_WHITE_PAWN: return 'P';
+        case CHESS_PIECE_WHITE_ROOK: return 'R';
+        case CHESS_PIECE_WHITE_KNIGHT: return 'N';
+        case CHESS_PIECE_WHITE_BISHOP: return 'B';
+        case CHESS_PIECE_WHITE_QUEEN: return 'Q';
+        case CHESS_PIECE_WHITE_KING: return 'K';
+        case CHESS_PIECE_BLACK_PAWN: return 'p';
+        case CHESS_PIECE_BLACK_ROOK: return 'r';
+        case CHESS_PIECE_BLACK_KNIGHT: return 'n';
+        case CHESS_PIECE_BLACK_BISHOP: return 'b';
+        case CHESS_PIECE_BLACK_QUEEN: return 'q';
+        case CHESS_PIECE_BLACK_KING: return 'k';
+        default: return '?';
+    }
+}
+
+bool ChessGame_IsValidPosition(ChessGame *game) {
+    if (!game) return false;
+    int whiteKings = 0, blackKings = 0;
+    for (int x = 0; x < CHESS_GRID; x++) {
+        for (int y = 0; y < CHESS_GRID; y++) {
+            ChessPiece piece = CHESS_BOARD_AT(game, x, y);
+            if ((piece == CHESS_PIECE_WHITE_PAWN && y == 0) ||
+                (piece == CHESS_PIECE_BLACK_PAWN && y == CHESS_GRID - 1)) {
+                return false; // pawns never move backwards
+            }
+            whiteKings += piece == CHESS_PIECE_WHITE_KING;
+            blackKings += piece == CHESS_PIECE_BLACK_KING;
+        }
+    }
+    if (whiteKings != 1 || blackKings != 1) return false;
+    return !isKingThreatenedBy(game, game->turn); // the player to move could capture the king
+}
+
+ChessResult ChessGame_FromFEN(ChessGame *game, const char *fen) {
+    if (!game || !fen) return CHESS_INVALID_ARGUMENT;
+    unsigned char board[CHESS_BOARD_SIZE];
+    memset(board, CHESS_PIECE_NONE, sizeof(board));
+    for (int y = CHESS_GRID - 1; y >= 0; y--) { // rank 8 first
+        for (int x = 0; x < CHESS_GRID;) {
+            if (*fen >= '1' && *fen <= '8') {
+                if (fen[1] >= '1' && fen[1] <= '8') return CHESS_INVALID_ARGUMENT; // "21" for "3"
+                int empty = *fen++ - '0';
+                if (x + empty > CHESS_GRID) return CHESS_INVALID_ARGUMENT;
+                x += empty;
+                continue;
+            }
+            ChessPiece piece = getFenPiece(*fen++);
+            if (piece == CHESS_PIECE_NONE) return CHESS_INVALID_ARGUMENT;
+            board[CHESS_BOARD_SQUARE(x++, y)] = piece;
+        }
+        if (y > 0 && *fen++ != '/') return CHESS_INVALID_ARGUMENT;
+    }
+    if (!skipFenSeparator(&fen)) return CHESS_INVALID_ARGUMENT;
+    ChessColor turn;
+    switch (*fen++) {
+        case 'w': turn = CHESS_PLAYER_COLOR_WHITE; break;
+        case 'b': turn = CHESS_PLAYER_COLOR_BLACK; break;
+        default: return CHESS_INVALID_ARGUMENT;
+    }
+    // castling & en passant don't exist in this variant: validated, then ignored
+    if (!skipFenSeparator(&fen)) return CHESS_INVALID_ARGUMENT;
+    if (*fen == '-') {
+        fen++;
+    } else {
+        const char *rights = "KQkq";
+        if (!*fen || !strchr(rights, *fen)) return CHESS_INVALID_ARGUMENT;
+        while (*fen && strchr(rights, *fen)) rights = strchr(rights, *fen++) + 1;
+    }
+    if (!skipFenSeparator(&fen)) return CHESS_INVALID_ARGUMENT;
+    if (*fen == '-') {
+        fen++;
+    } else if (*fen >= 'a' && *fen <= 'h' && (fen[1] == '3' || fen[1] == '6')) {
+        fen += 2;
+    } else {
+        return CHESS_INVALID_ARGUMENT;
+    }
+    // the move clocks are optional, as in EPD records
+    unsigned int halfmoveClock = 0, fullmoveNumber = 1;
+    const char *clocks = fen;
+    if (skipFenSeparator(&clocks) && isdigit((unsigned char)*clocks)) {
+        if (!parseFenNumber(&clocks, &halfmoveClock) || !skipFenSeparator(&clocks) ||
+            !parseFenNumber(&clocks, &fullmoveNumber) || fullmoveNumber == 0) {
+            return CHESS_INVALID_ARGUMENT;
+        }
+        fen = clocks;
+    }
+    if (*fen && !isspace((unsigned char)*fen)) return CHESS_INVALID_ARGUMENT;
+    unsigned char previousBoard[CHESS_BOARD_SIZE];
+    ChessColor previousTurn = game->turn;
+    memcpy(previousBoard, game->board, sizeof(previousBoard));
+    memcpy(game->board, board, sizeof(board));
+    game->turn = turn;
+    if (!ChessGame_IsValidPosition(game)) {
+        memcpy(game->board, previousBoard, sizeof(previousBoard));
+        game->turn = previousTurn;
+        return CHESS_INVALID_ARGUMENT;
+    }
+    game->halfmoveClock = halfmoveClock;
+    game->fullmoveNumber = fullmoveNumber;
+    ChessGame_ClearHistory(game);
+    return ChessGame_RefreshState(game);
+}
+
+ChessResult ChessGame_ToFEN(const ChessGame *game, char *fen) {
+    if (!game || !fen) return CHESS_INVALID_ARGUMENT;
+    for (int y = CHESS_GRID - 1; y >= 0; y--) { // rank 8 first
+        int empty = 0;
+        for (int x = 0; x < CHESS_GRID; x++) {
+            ChessPiece piece = CHESS_BOARD_AT(game, x, y);
+            if (piece == CHESS_PIECE_NONE) {
+                empty++;
+                continue;
+            }
+            if (empty) *fen++ = '0' + empty;
+            empty = 0;
+            *fen++ = getPieceFenLetter(piece);
+        }
+        if (empty) *fen++ = '0' + empty;
+        if (y > 0) *fen++ = '/';
+    }
+    sprintf(fen, " %c - - %u %u", game->turn == CHESS_PLAYER_COLOR_WHITE ? 'w' : 'b',
+            game->halfmoveClock, game->fullmoveNumber);
+    return CHESS_SUCCESS;
+}
+
+/**
+ * Retrieve the ChessPiece of a given SAN piece letter.
+ * @param   letter      the piece letter, 'P' for a pawn
+ * @param   color       the piece's player
+ * @return  CHESS_PIECE_NONE if letter isn't a piece letter
+ *          the piece otherwise
+ */
+ChessPiece getSanPiece(char letter, ChessColor color) {
+    ChessPiece piece = getFenPiece(letter); // uppercase for white
+    if (piece == CHESS_PIECE_NONE || color == CHESS_PLAYER_COLOR_WHITE) return piece;
+    return getFenPiece(tolower((unsigned char)letter));
+}
+
+ChessResult ChessGame_ToSAN(ChessGame *game, ChessMove move, char *san) {
+    if (!game || !san) return CHESS_INVALID_ARGUMENT;
+    ChessResult result = isValidMove(game, move);
+    if (result != CHESS_SUCCESS) return result;
+    ChessPiece piece = CHESS_BOARD_AT(game, move.from.x, move.from.y);
+    bool isCapture = CHESS_BOARD_AT(game, move.to.x, move.to.y) != CHESS_PIECE_NONE;
+    if (isPawn(piece)) {
+        if (isCapture) *san++ = 'a' + move.from.x;
+    } else {
+        *san++ = toupper((unsigned char)getPieceFenLetter(piece));
+        bool isAmbiguous = false, isSameX = false, isSameY = false;
+        ChessMove other = { .to = move.to };
+        for (int x = 0; x < CHESS_GRID; x++) {
+            for (int y = 0; y < CHESS_GRID; y++) {
+                if (CHESS_BOARD_AT(game, x, y) != piece || (x == move.from.x && y == move.from.y)) continue;
+                other.from = (ChessPos){ .x = x, .y = y };
+                if (isValidMove(game, other) != CHESS_SUCCESS) continue;
+                isAmbiguous = true;
+                isSameX |= x == move.from.x;
+                isSameY |= y == move.from.y;
+            }
+        }
+        if (isAmbiguous && (!isSameX || isSameY)) *san++ = 'a' + move.from.x;
+        if (isAmbiguous && isSameX) *san++ = '1' + move.from.y;
+    }
+    if (isCapture) *san++ = 'x';
+    *san++ = 'a' + move.to.x;
+    *san++ = '1' + move.to.y;
+    ChessColor player = game->turn;
+    pseudoDoMove(game, &move);
+    game->turn = switchColor(player);
+    if (isKingThreatenedBy(game, player)) *san++ = hasMoves(game) ? '+' : '#';
+    game->turn = player;
+    pseudoUndoMove(game, &move);
+    *san = '\0';
+    return CHESS_SUCCESS;
+}
+
+ChessResult ChessGame_FromSAN(ChessGame *game, const char *san, ChessMove *move) {
+    if (!game || !san || !move) return CHESS_INVALID_ARGUMENT;
+    char squares[4]; // san's file & rank characters only
+    int length = 0;
+    ChessPiece piece = getSanPiece(isupper((unsigned char)*san) ? *san++ : 'P', game->turn);
+    for (; *san && !isspace((unsigned char)*san) && !strchr("+#!?", *san); san++) {
+        if (*san == 'x' || *san == '-') continue; // a capture, or long algebraic notation
+        if (length == 4 || !((*san >= 'a' && *san <= 'h') || (*san >= '1' && *san <= '8'))) {
+            return CHESS_INVALID_ARGUMENT;
+        }
+        squares[length++] = *san;
+    }
+    if (piece == CHESS_PIECE_NONE || length < 2) return CHESS_INVALID_ARGUMENT;
+    if (!isalpha((unsigned char)squares[length - 2]) || !isdigit((unsigned char)squares[length - 1])) {
+        return CHESS_INVALID_ARGUMENT;
+    }
+    ChessPos to = { .x = squares[length - 2] - 'a', .y = squares[length - 1] - '1' };
+    int fromX = -1, fromY = -1;
+    for (int i = 0; i < length - 2; i++) {
+        if (isalpha((unsigned char)squares[i])) fromX = squares[i] - 'a';
+        if (isdigit((unsigned char)squares[i])) fromY = squares[i] - '1';
+    }
+    int matches = 0;
+    ChessMove candidate = { .to = to, .capturedPiece = CHESS_PIECE_NONE };
+    for (int x = 0; x < CHESS_GRID; x++) {
+        for (int y = 0; y < CHESS_GRID; y++) {
+            if (CHESS_BOARD_AT(game, x, y) != piece) continue;
+            if ((fromX >= 0 && x != fromX) || (fromY >= 0 && y != fromY)) continue;
+            candidate.from = (ChessPos){ .x = x, .y = y };
+            if (isValidMove(game, candidate) != CHESS_SUCCESS) continue;
+            *move = candidate;
+            matches++;
+        }
+    }
+    return matches == 1 ? CHESS_SUCCESS : CHESS_INVALID_ARGUMENT;
+}
@@ -1,9 +1,33 @@
 #ifndef CHESS_GAME_H_
 #define CHESS_GAME_H_
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "ArrayStack.h"
+#include "ChessNnue.h"
 
-#define CHESS_GRID 8
+#define CHESS_GRID                  8
+#define CHESS_FIFTY_MOVE_LIMIT      100 // half-moves without a capture or a pawn move
+#define CHESS_FEN_SIZE              100 // the longest FEN record, with its null terminator
+#define CHESS_SAN_SIZE              8 // the longest SAN move, e.g. "Qd1xd8#", with its null terminator
+#define CHESS_MAX_MOVES             256 // valid moves of any position, see ChessGame_GetAllMoves()
+
+// the board's 0x88 layout: rows of 16 squares, the first 8 of each on board
+#define CHESS_BOARD_ROW             16
+#define CHESS_BOARD_SIZE            (CHESS_GRID * CHESS_BOARD_ROW)
+#define CHESS_BOARD_SQUARE(x, y)    ((y) * CHESS_BOARD_ROW + (x))
+#define CHESS_BOARD_AT(game, x, y)  ((game)->board[CHESS_BOARD_SQUARE(x, y)]) // a ChessPiece
+
+// a ChessPackedMove: the from square, then the to square (each y * CHESS_GRID + x),
+// 6 bits each from the lowest, then flags
+#define CHESS_MOVE_NONE             0 // from & to the same square, never a valid move
+#define CHESS_MOVE_SQUARE_BITS      6
+#define CHESS_MOVE_SQUARE_MASK      ((1 << CHESS_MOVE_SQUARE_BITS) - 1)
+#define CHESS_MOVE_FLAG_CAPTURE     (1 << 12)
+#define CHESS_MOVE_PACK(from, to, flags) \
+    ((ChessPackedMove)((from) | (to) << CHESS_MOVE_SQUARE_BITS | (flags)))
+#define CHESS_MOVE_FROM(move)       ((move) & CHESS_MOVE_SQUARE_MASK)
+#define CHESS_MOVE_TO(move)         (((move) >> CHESS_MOVE_SQUARE_BITS) & CHESS_MOVE_SQUARE_MASK)
 
 
 typedef enum ChessResult {
@@ -52,13 +76,46 @@ typedef enum ChessPiece {
     CHESS_PIECE_BLACK_KING      = 'K',
 } ChessPiece;
 
+typedef uint16_t ChessPackedMove;
+
+/**
+ * A move of a ChessGame's history, packed with the state needed to undo it.
+ * This variant has no castling, en passant or promotion, so no move flags.
+ */
+typedef struct ChessHistoryEntry {
+    uint64_t hash; // of the position before the move
+    uint32_t halfmoveClock; // before the move
+    ChessPackedMove move; // without flags
+    char capturedPiece; // a ChessPiece
+} ChessHistoryEntry;
+
+/**
+ * A ChessGame's moves, growing as needed. Undone moves are kept past its
+ * size until a new move is done, so they can be redone.
+ */
+typedef struct ChessHistory {
+    ChessHistoryEntry *entries;
+    unsigned int size; // moves done
+    unsigned int length; // moves done, and undone moves that can be redone
+    unsigned int capacity;
+} ChessHistory;
+
 typedef struct ChessGame {
     ChessColor turn;
     ChessMode mode;
     ChessDifficulty difficulty;
     ChessColor userColor;
-    ChessPiece board[CHESS_GRID][CHESS_GRID];
-    ArrayStack *history;
+    unsigned char board[CHESS_BOARD_SIZE]; // ChessPieces, off-board squares CHESS_PIECE_NONE
+    ChessHistory history;
+    uint64_t hash;
+    uint64_t pawnHash; // Zobrist hash of the pawns & kings only
+    int midgameScore;
+    int endgameScore;
+    int phase;
+    uint64_t occupancy[2]; // squares of each ChessColor's pieces, as a ChessBitboard
+    ChessNnueAccumulator accumulator; // maintained only while a network is loaded
+    unsigned int halfmoveClock;
+    unsigned int fullmoveNumber; // starts at 1, incremented after each black move
 } ChessGame;
 
 typedef enum ChessStatus {
@@ -86,8 +143,23 @@ typedef struct ChessMove {
     ChessPos to;
     ChessPiece capturedPiece;
     ChessColor player;
+    unsigned int halfmoveClock;
 } ChessMove;
 
+/**
+ * Pack a given move's from & to positions into a ChessPackedMove.
+ * @param   move        the move to pack, its positions on the board
+ * @return  the packed move, without flags
+ */
+ChessPackedMove ChessGame_PackMove(ChessMove move);
+
+/**
+ * Unpack a given ChessPackedMove.
+ * @param   move        the move to unpack
+ * @return  the move, with only its from & to positions set
+ */
+ChessMove ChessGame_UnpackMove(ChessPackedMove move);
+
 /**
  * Create new ChessGame instance.
  * @return  NULL if malloc failed
@@ -97,6 +169,7 @@ ChessGame* ChessGame_Create();
 
 /**
  * Create a copy of a given ChessGame instance.
+ * Undone moves of its history aren't copied, so they can't be redone.
  * @param   game        the instance to copy
  * @return  NULL if malloc failed
  *          ChessGame* instance otherwise
@@ -166,8 +239,21 @@ ChessResult ChessGame_SetUserColor(ChessGame *game, ChessColor userColor);
  */
 ChessResult ChessGame_InitBoard(ChessGame *game);
 
+/**
+ * Recalculate the state derived from a given ChessGame's board & turn
+ * (such as its Zobrist hashes, material + piece-square scores, phase,
+ * occupancy bitboards and NNUE accumulator). Should be called after the board
+ * was modified directly rather than through ChessGame_DoMove().
+ * @param   game        the instance to refresh
+ * @return  CHESS_INVALID_ARGUMENT if game == NULL
+ *          CHESS_SUCCESS otherwise
+ */
+ChessResult ChessGame_RefreshState(ChessGame *game);
+
 /**
  * Calculate a GameStatus of a given ChessGame.
+ * A game with CHESS_FIFTY_MOVE_LIMIT half-moves since the last capture
+ * or pawn move is a draw (unless it's a checkmate).
  * @param   game        the instance to calculate a ChessStatus on
  * @param   status      output parameter of the ChessGame's status
  * @return  CHESS_INVALID_ARGUMENT if game == NULL
@@ -189,7 +275,9 @@ ChessResult ChessGame_GetGameStatus(ChessGame *game, ChessStatus *status);
  *              the move won't change that status
  *          CHESS_KING_WILL_BE_THREATENED if the move will expose the
  *              player to CHECK
+ *          CHESS_INVALID_ARGUMENT if the history can't grow
  *          CHESS_SUCCESS otherwise (there's no other choise left!)
+ * The history's undone moves are dropped, so they can't be redone.
  */
 ChessResult ChessGame_DoMove(ChessGame *game, ChessMove move);
 
@@ -203,6 +291,45 @@ ChessResult ChessGame_DoMove(ChessGame *game, ChessMove move);
  */
 ChessResult ChessGame_UndoMove(ChessGame *game, ChessMove *move);
 
+/**
+ * Redo the last move undone on a given ChessGame, if no move was done since.
+ * @param   game        the instance to redo a move on
+ * @param   move        output parameter for the move that was redone,
+ *                      won't change in operation failed
+ * @return  CHESS_INVALID_ARGUMENT if game == NULL or move == NULL
+ *          CHESS_EMPTY_HISTORY if there are no moves to redo
+ *          CHESS_SUCCESS otherwise (after redo a move)
+ */
+ChessResult ChessGame_RedoMove(ChessGame *game, ChessMove *move);
+
+/**
+ * Retrieve the number of moves done on a given ChessGame, as can be undone.
+ * @param   game        the instance to count the moves of
+ * @return  0 if game == NULL
+ *          the size of the game's history otherwise
+ */
+unsigned int ChessGame_GetHistorySize(const ChessGame *game);
+
+/**
+ * Retrieve a given move of a given ChessGame's history.
+ * @param   game        the instance to retrieve the move of
+ * @param   index       the move's index, counting from the first move (index 0)
+ * @param   move        output parameter for the move, with its from & to
+ *                      positions, player, captured piece and halfmove clock set
+ * @return  CHESS_INVALID_ARGUMENT if game == NULL, move == NULL or
+ *              index is out of the history's size
+ *          CHESS_SUCCESS otherwise
+ */
+ChessResult ChessGame_GetHistoryMove(const ChessGame *game, unsigned int index, ChessMove *move);
+
+/**
+ * Clear a given ChessGame's history, e.g. after its board was set directly.
+ * @param   game        the instance to clear the history of
+ * @return  CHESS_INVALID_ARGUMENT if game == NULL
+ *          CHESS_SUCCESS otherwise
+ */
+ChessResult ChessGame_ClearHistory(ChessGame *game);
+
 /**
  * Calculate a list of all possible moves for a given ChessPos.
  * The third argument will be redirecred to an ArrayStack* of ChessPos's
@@ -218,6 +345,18 @@ ChessResult ChessGame_UndoMove(ChessGame *game, ChessMove *move);
  */
 ChessResult ChessGame_GetMoves(ChessGame *game, ChessPos pos, ArrayStack **stack);
 
+/**
+ * Calculate a list of all valid moves of a given ChessGame's player to move,
+ * in the board's order: by from position, then by to position, each by
+ * column and then by row.
+ * @param   game        the instance to calculate moves on
+ * @param   moves       output parameter for the moves, of CHESS_MAX_MOVES,
+ *                      flagged with CHESS_MOVE_FLAG_CAPTURE if they capture
+ * @return  0 if game == NULL or moves == NULL
+ *          the number of moves otherwise
+ */
+unsigned int ChessGame_GetAllMoves(ChessGame *game, ChessPackedMove *moves);
+
 /**
  * Retrieve a ChessColor for a given ChessPiece
  * @param   piece       the ChessPiece to retrieve the color for
@@ -226,5 +365,80 @@ ChessResult ChessGame_GetMoves(ChessGame *game, ChessPos pos, ArrayStack **stack
  */
 ChessResult ChessGame_GetPieceColor(ChessPiece piece, ChessColor *color);
 
+/**
+ * Check whether a given ChessGame's current position has already occurred,
+ * with the same player to move, since the last capture or pawn move.
+ * The position keys of both the game and any search on top of it are kept,
+ * so a repetition inside the search tree is detected as well.
+ * @param   game        the instance to check
+ * @return  true        if the current position is a repetition
+ *          false       otherwise, or if game == NULL
+ */
+bool ChessGame_IsRepetition(const ChessGame *game);
+
+/**
+ * Check whether a given ChessGame's board & player to move make a position
+ * this variant can reach: each player has exactly one king, no pawn is on
+ * its own back rank and the player to move can't capture the opponent king.
+ * @param   game        the instance to check
+ * @return  true        if the position is valid
+ *          false       otherwise, or if game == NULL
+ */
+bool ChessGame_IsValidPosition(ChessGame *game);
+
+/**
+ * Set up a given ChessGame from a given FEN (or EPD) record: the board,
+ * the player to move and the move clocks, in a single pass over the
+ * record and without allocating. The castling & en passant
+ * fields are validated but ignored, as is anything after the last field,
+ * such as EPD operations. The history is cleared, settings are kept.
+ * @param   game        the instance to set up
+ * @param   fen         the record, with or without its two move clocks
+ * @return  CHESS_INVALID_ARGUMENT if game == NULL or fen == NULL, if fen
+ *              is malformed, if a player doesn't have exactly one king,
+ *              if a pawn is on its own back rank or if the player to move
+ *              can capture the opponent king - the game is left unchanged
+ *          CHESS_SUCCESS otherwise
+ */
+ChessResult ChessGame_FromFEN(ChessGame *game, const char *fen);
+
+/**
+ * Write the FEN record of a given ChessGame's current position. As this
+ * variant has no castling or en passant, both fields are always "-".
+ * @param   game        the instance to write
+ * @param   fen         output parameter for the record, of CHESS_FEN_SIZE chars
+ * @return  CHESS_INVALID_ARGUMENT if game == NULL or fen == NULL
+ *          CHESS_SUCCESS otherwise
+ */
+ChessResult ChessGame_ToFEN(const ChessGame *game, char *fen);
+
+/**
+ * Write a given move of a given ChessGame in Standard Algebraic Notation,
+ * e.g. "Nbxd7+". The game's position is used to check the move, but is
+ * left unchanged.
+ * @param   game        the game the move is to be done in
+ * @param   move        the move to write
+ * @param   san         output parameter for the move, of CHESS_SAN_SIZE chars
+ * @return  CHESS_INVALID_ARGUMENT if game == NULL or san == NULL
+ *          the reason the move is invalid, if it is
+ *          CHESS_SUCCESS otherwise
+ */
+ChessResult ChessGame_ToSAN(ChessGame *game, ChessMove move, char *san);
+
+/**
+ * Resolve a move in Standard Algebraic Notation, e.g. "Nbxd7+", or in long
+ * algebraic notation, e.g. "Nb8-d7", into a valid move of a given ChessGame.
+ * Castling and promotions aren't part of this game, so they don't resolve.
+ * The game's position is used to check the move, but is left unchanged.
+ * @param   game        the game the move is to be done in
+ * @param   san         the move, anything after it (e.g. "!?") is ignored
+ * @param   move        output parameter for the move, with only its
+ *                      from & to positions set
+ * @return  CHESS_INVALID_ARGUMENT if game == NULL, san == NULL or move == NULL,
+ *              or if not exactly one valid move matches san
+ *          CHESS_SUCCESS otherwise
+ */
+ChessResult ChessGame_FromSAN(ChessGame *game, const char *san, ChessMove *move);
+
 
 #endif
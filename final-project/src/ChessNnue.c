@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <string.h>
+#include "ChessNnue.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHESS_NNUE_X86
+#endif
+
+#define NNUE_MAGIC          "CNNU"
+#define NNUE_VERSION        1
+#define L1_INPUTS           (2 * CHESS_NNUE_HIDDEN_SIZE)
+#define L1_SIZE             32
+#define L2_SIZE             32
+#define ACTIVATION_MAX      127
+#define WEIGHT_SHIFT        6   // dense layers' int8 weights are scaled by 64
+#define OUTPUT_SCALE        16  // network output units per centipawn
+#define PIECE_INDEXES       12
+#define SQUARES             64
+#define SQUARE_MIRROR       56  // flips a square's row: y * 8 + x -> (7 - y) * 8 + x
+
+
+typedef void (*DenseKernel)(const uint8_t *input, int inputSize,
+                            const int8_t *weights, const int32_t *biases,
+                            int32_t *output, int outputSize);
+
+static int16_t featureBiases[CHESS_NNUE_HIDDEN_SIZE];
+static int16_t featureWeights[CHESS_NNUE_FEATURES][CHESS_NNUE_HIDDEN_SIZE];
+static int32_t l1Biases[L1_SIZE];
+static int8_t l1Weights[L1_SIZE][L1_INPUTS];
+static int32_t l2Biases[L2_SIZE];
+static int8_t l2Weights[L2_SIZE][L1_SIZE];
+static int32_t outputBias;
+static int8_t outputWeights[L2_SIZE];
+static bool isLoaded = false;
+static bool isKernelSelected = false;
+static ChessNnueKernel kernel = CHESS_NNUE_KERNEL_SCALAR;
+static DenseKernel dense = NULL;
+
+void denseScalar(const uint8_t *input, int inputSize,
+                 const int8_t *weights, const int32_t *biases,
+                 int32_t *output, int outputSize) {
+    for (int i = 0; i < outputSize; i++) {
+        const int8_t *row = weights + i * inputSize;
+        int32_t sum = biases[i];
+        for (int j = 0; j < inputSize; j++) {
+            sum += input[j] * row[j];
+        }
+        output[i] = sum;
+    }
+}
+
+#ifdef CHESS_NNUE_X86
+// input sizes are multiples of 32, and inputs are at most ACTIVATION_MAX,
+// so the 16-bit pair sums of maddubs can't saturate
+
+__attribute__((target("sse4.1")))
+void denseSse41(const uint8_t *input, int inputSize,
+                const int8_t *weights, const int32_t *biases,
+                int32_t *output, int outputSize) {
+    const __m128i ones = _mm_set1_epi16(1);
+    for (int i = 0; i < outputSize; i++) {
+        const int8_t *row = weights + i * inputSize;
+        __m128i sum = _mm_setzero_si128();
+        for (int j = 0; j < inputSize; j += 16) {
+            __m128i in = _mm_loadu_si128((const __m128i *)(input + j));
+            __m128i weight = _mm_loadu_si128((const __m128i *)(row + j));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(in, weight), ones));
+        }
+        sum = _mm_hadd_epi32(sum, sum);
+        sum = _mm_hadd_epi32(sum, sum);
+        output[i] = biases[i] + _mm_cvtsi128_si32(sum);
+    }
+}
+
+__attribute__((target("avx2")))
+void denseAvx2(const uint8_t *input, int inputSize,
+               const int8_t *weights, const int32_t *biases,
+               int32_t *output, int outputSize) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int i = 0; i < outputSize; i++) {
+        const int8_t *row = weights + i * inputSize;
+        __m256i sum = _mm256_setzero_si256();
+        for (int j = 0; j < inputSize; j += 32) {
+            __m256i in = _mm256_loadu_si256((const __m256i *)(input + j));
+            __m256i weight = _mm256_loadu_si256((const __m256i *)(row + j));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, weight), ones));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                     _mm256_extracti128_si256(sum, 1));
+        half = _mm_hadd_epi32(half, half);
+        half = _mm_hadd_epi32(half, half);
+        output[i] = biases[i] + _mm_cvtsi128_si32(half);
+    }
+}
+#endif
+
+bool isKernelSupported(ChessNnueKernel candidate) {
+    switch (candidate) {
+        case CHESS_NNUE_KERNEL_SCALAR:
+            return true;
+#ifdef CHESS_NNUE_X86
+        case CHESS_NNUE_KERNEL_SSE41:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.1");
+        case CHESS_NNUE_KERNEL_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+DenseKernel getDenseKernel(ChessNnueKernel candidate) {
+    switch (candidate) {
+#ifdef CHESS_NNUE_X86
+        case CHESS_NNUE_KERNEL_SSE41:
+            return denseSse41;
+        case CHESS_NNUE_KERNEL_AVX2:
+            return denseAvx2;
+#endif
+        case CHESS_NNUE_KERNEL_SCALAR:
+        default:
+            return denseScalar;
+    }
+}
+
+/**
+ * Pick the fastest supported kernel, unless one was already picked.
+ */
+void selectKernel() {
+    if (isKernelSelected) return;
+    if (isKernelSupported(CHESS_NNUE_KERNEL_AVX2)) {
+        kernel = CHESS_NNUE_KERNEL_AVX2;
+    } else if (isKernelSupported(CHESS_NNUE_KERNEL_SSE41)) {
+        kernel = CHESS_NNUE_KERNEL_SSE41;
+    } else {
+        kernel = CHESS_NNUE_KERNEL_SCALAR;
+    }
+    dense = getDenseKernel(kernel);
+    isKernelSelected = true;
+}
+
+/**
+ * Read a little-endian uint32 from a given file.
+ * @return  false if the file ended
+ */
+bool readUint32(FILE *fp, uint32_t *value) {
+    unsigned char bytes[4];
+    if (fread(bytes, 1, sizeof(bytes), fp) != sizeof(bytes)) return false;
+    *value = bytes[0] | bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    return true;
+}
+
+bool readWeights(FILE *fp) {
+    char magic[4];
+    uint32_t version, hiddenSize, l1Size, l2Size;
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic)) return false;
+    if (memcmp(magic, NNUE_MAGIC, sizeof(magic))) return false;
+    if (!readUint32(fp, &version) || version != NNUE_VERSION) return false;
+    if (!readUint32(fp, &hiddenSize) || hiddenSize != CHESS_NNUE_HIDDEN_SIZE) return false;
+    if (!readUint32(fp, &l1Size) || l1Size != L1_SIZE) return false;
+    if (!readUint32(fp, &l2Size) || l2Size != L2_SIZE) return false;
+    // the weights are read as-is, this assumes a little-endian host
+    return fread(featureBiases, sizeof(featureBiases), 1, fp) == 1 &&
+           fread(featureWeights, sizeof(featureWeights), 1, fp) == 1 &&
+           fread(l1Biases, sizeof(l1Biases), 1, fp) == 1 &&
+           fread(l1Weights, sizeof(l1Weights), 1, fp) == 1 &&
+           fread(l2Biases, sizeof(l2Biases), 1, fp) == 1 &&
+           fread(l2Weights, sizeof(l2Weights), 1, fp) == 1 &&
+           fread(&outputBias, sizeof(outputBias), 1, fp) == 1 &&
+           fread(outputWeights, sizeof(outputWeights), 1, fp) == 1 &&
+           fgetc(fp) == EOF;
+}
+
+bool ChessNnue_Load(const char *path) {
+    isLoaded = false;
+    if (!path) return false;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+    isLoaded = readWeights(fp);
+    fclose(fp);
+    selectKernel();
+    return isLoaded;
+}
+
+/**
+ * Generate the next pseudo-random number of a xorshift64* sequence,
+ * in the range [min, max].
+ * @param   state       the generator state, updated in place
+ */
+int nextRandomInRange(uint64_t *state, int min, int max) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    uint64_t value = *state * 0x2545F4914F6CDD1DULL;
+    return min + (int)((value >> 33) % (uint64_t)(max - min + 1));
+}
+
+void ChessNnue_LoadRandom(uint64_t seed) {
+    uint64_t state = seed ? seed : 1;
+    for (int i = 0; i < CHESS_NNUE_HIDDEN_SIZE; i++) {
+        featureBiases[i] = nextRandomInRange(&state, 0, 64);
+    }
+    for (int i = 0; i < CHESS_NNUE_FEATURES; i++) {
+        for (int j = 0; j < CHESS_NNUE_HIDDEN_SIZE; j++) {
+            featureWeights[i][j] = nextRandomInRange(&state, -32, 32);
+        }
+    }
+    for (int i = 0; i < L1_SIZE; i++) {
+        l1Biases[i] = nextRandomInRange(&state, -1024, 1024);
+        for (int j = 0; j < L1_INPUTS; j++) {
+            l1Weights[i][j] = nextRandomInRange(&state, -16, 16);
+        }
+    }
+    for (int i = 0; i < L2_SIZE; i++) {
+        l2Biases[i] = nextRandomInRange(&state, -1024, 1024);
+        for (int j = 0; j < L1_SIZE; j++) {
+            l2Weights[i][j] = nextRandomInRange(&state, -64, 64);
+        }
+        outputWeights[i] = nextRandomInRange(&state, -64, 64);
+    }
+    outputBias = 0;
+    isLoaded = true;
+    selectKernel();
+}
+
+void ChessNnue_Unload() {
+    isLoaded = false;
+}
+
+bool ChessNnue_IsLoaded() {
+    return isLoaded;
+}
+
+ChessNnueKernel ChessNnue_GetKernel() {
+    selectKernel();
+    return kernel;
+}
+
+bool ChessNnue_SetKernel(ChessNnueKernel newKernel) {
+    if (!isKernelSupported(newKernel)) return false;
+    kernel = newKernel;
+    dense = getDenseKernel(kernel);
+    isKernelSelected = true;
+    return true;
+}
+
+const char* ChessNnue_KernelToString(ChessNnueKernel kernelToName) {
+    switch (kernelToName) {
+        case CHESS_NNUE_KERNEL_SSE41:
+            return "sse4.1";
+        case CHESS_NNUE_KERNEL_AVX2:
+            return "avx2";
+        case CHESS_NNUE_KERNEL_SCALAR:
+        default:
+            return "scalar";
+    }
+}
+
+void ChessNnue_ResetAccumulator(ChessNnueAccumulator *accumulator) {
+    memcpy(accumulator->values[0], featureBiases, sizeof(featureBiases));
+    memcpy(accumulator->values[1], featureBiases, sizeof(featureBiases));
+}
+
+/**
+ * Retrieve the feature index of a given piece & square, from a given perspective.
+ * The black perspective sees the board flipped, with the colors swapped.
+ */
+int getFeatureIndex(int perspective, int pieceIndex, int square) {
+    if (perspective == 0) return pieceIndex * SQUARES + square;
+    int flippedIndex = (pieceIndex + PIECE_INDEXES / 2) % PIECE_INDEXES;
+    return flippedIndex * SQUARES + (square ^ SQUARE_MIRROR);
+}
+
+void ChessNnue_AddFeature(ChessNnueAccumulator *accumulator, int pieceIndex, int square) {
+    for (int perspective = 0; perspective < 2; perspective++) {
+        const int16_t *weights = featureWeights[getFeatureIndex(perspective, pieceIndex, square)];
+        int16_t *values = accumulator->values[perspective];
+        for (int i = 0; i < CHESS_NNUE_HIDDEN_SIZE; i++) {
+            values[i] += weights[i];
+        }
+    }
+}
+
+void ChessNnue_RemoveFeature(ChessNnueAccumulator *accumulator, int pieceIndex, int square) {
+    for (int perspective = 0; perspective < 2; perspective++) {
+        const int16_t *weights = featureWeights[getFeatureIndex(perspective, pieceIndex, square)];
+        int16_t *values = accumulator->values[perspective];
+        for (int i = 0; i < CHESS_NNUE_HIDDEN_SIZE; i++) {
+            values[i] -= weights[i];
+        }
+    }
+}
+
+/**
+ * Apply the clipped ReLU activation on given values.
+ * @param   values      the values to activate
+ * @param   size        the number of values
+ * @param   shift       right shift to apply before clipping
+ * @param   output      output parameter for the activated values
+ */
+void activate32(const int32_t *values, int size, int shift, uint8_t *output) {
+    for (int i = 0; i < size; i++) {
+        int32_t value = values[i] >> shift;
+        output[i] = value < 0 ? 0 : value > ACTIVATION_MAX ? ACTIVATION_MAX : value;
+    }
+}
+
+void activate16(const int16_t *values, int size, uint8_t *output) {
+    for (int i = 0; i < size; i++) {
+        int16_t value = values[i];
+        output[i] = value < 0 ? 0 : value > ACTIVATION_MAX ? ACTIVATION_MAX : value;
+    }
+}
+
+int ChessNnue_Evaluate(const ChessNnueAccumulator *accumulator, bool isWhiteTurn) {
+    if (!isLoaded || !accumulator) return 0;
+    uint8_t input[L1_INPUTS];
+    int32_t l1Output[L1_SIZE], l2Output[L2_SIZE], output;
+    uint8_t l1Activated[L1_SIZE], l2Activated[L2_SIZE];
+    int us = isWhiteTurn ? 0 : 1; // player to move's perspective comes first
+    activate16(accumulator->values[us], CHESS_NNUE_HIDDEN_SIZE, input);
+    activate16(accumulator->values[!us], CHESS_NNUE_HIDDEN_SIZE, input + CHESS_NNUE_HIDDEN_SIZE);
+    dense(input, L1_INPUTS, &l1Weights[0][0], l1Biases, l1Output, L1_SIZE);
+    activate32(l1Output, L1_SIZE, WEIGHT_SHIFT, l1Activated);
+    dense(l1Activated, L1_SIZE, &l2Weights[0][0], l2Biases, l2Output, L2_SIZE);
+    activate32(l2Output, L2_SIZE, WEIGHT_SHIFT, l2Activated);
+    dense(l2Activated, L2_SIZE, outputWeights, &outputBias, &output, 1);
+    int score = output / OUTPUT_SCALE;
+    return isWhiteTurn ? score : -score;
+}
@@ -0,0 +1,112 @@
+#ifndef CHESS_NNUE_H_
+#define CHESS_NNUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CHESS_NNUE_FEATURES         768 // 12 piece types * 64 squares
+#define CHESS_NNUE_HIDDEN_SIZE      128
+
+
+/**
+ * The first layer of the network, for both perspectives (0 - white, 1 - black).
+ * Kept by every ChessGame and updated incrementally as pieces move.
+ */
+typedef struct ChessNnueAccumulator {
+    int16_t values[2][CHESS_NNUE_HIDDEN_SIZE];
+} ChessNnueAccumulator;
+
+typedef enum ChessNnueKernel {
+    CHESS_NNUE_KERNEL_SCALAR,
+    CHESS_NNUE_KERNEL_SSE41,
+    CHESS_NNUE_KERNEL_AVX2,
+} ChessNnueKernel;
+
+/**
+ * Load the network weights from a given file, replacing any loaded network.
+ * The file is little-endian: a "CNNU" magic, a uint32 version and the
+ * uint32 hidden, first & second dense layer sizes, followed by the int16
+ * feature transformer biases & weights, and for each dense layer its
+ * int32 biases and int8 weights (output-major).
+ * @param   path        the weights file path
+ * @return  true        if the network was loaded
+ *          false       if the file can't be read or doesn't match this build
+ */
+bool ChessNnue_Load(const char *path);
+
+/**
+ * Fill the network with pseudo-random weights from a given seed.
+ * Only useful for benchmarking the inference speed.
+ * @param   seed        the generator seed
+ */
+void ChessNnue_LoadRandom(uint64_t seed);
+
+/**
+ * Unload the network, if loaded.
+ */
+void ChessNnue_Unload();
+
+/**
+ * Signal if a network is loaded, in which case it replaces the classical
+ * evaluation and ChessGame maintains its accumulator.
+ * @return  true        if a network is loaded
+ *          false       otherwise
+ */
+bool ChessNnue_IsLoaded();
+
+/**
+ * Retrieve the kernel used by the dense layers.
+ * The fastest kernel the CPU supports is picked at runtime.
+ * @return  the current kernel
+ */
+ChessNnueKernel ChessNnue_GetKernel();
+
+/**
+ * Force the dense layers to use a given kernel.
+ * @param   kernel      the kernel to use
+ * @return  true        if kernel is supported by the CPU
+ *          false       otherwise (the current kernel is kept)
+ */
+bool ChessNnue_SetKernel(ChessNnueKernel kernel);
+
+/**
+ * Retrieve a printable name of a given kernel.
+ * @param   kernel      the kernel to name
+ * @return  the kernel name
+ */
+const char* ChessNnue_KernelToString(ChessNnueKernel kernel);
+
+/**
+ * Set a given accumulator to the feature transformer biases (an empty board).
+ * @param   accumulator the accumulator to reset
+ */
+void ChessNnue_ResetAccumulator(ChessNnueAccumulator *accumulator);
+
+/**
+ * Add a piece to a given accumulator.
+ * @param   accumulator the accumulator to update
+ * @param   pieceIndex  the piece index, 0-5 for white pieces and 6-11 for
+ *                      black pieces (pawn, rook, knight, bishop, queen, king)
+ * @param   square      the piece's square, y * 8 + x
+ */
+void ChessNnue_AddFeature(ChessNnueAccumulator *accumulator, int pieceIndex, int square);
+
+/**
+ * Remove a piece from a given accumulator.
+ * @param   accumulator the accumulator to update
+ * @param   pieceIndex  the piece index, as in ChessNnue_AddFeature()
+ * @param   square      the piece's square, y * 8 + x
+ */
+void ChessNnue_RemoveFeature(ChessNnueAccumulator *accumulator, int pieceIndex, int square);
+
+/**
+ * Run the dense layers of the network on a given accumulator.
+ * @param   accumulator the position's accumulator
+ * @param   isWhiteTurn whether white is the player to move
+ * @return  0           if no network is loaded
+ *          the position score in centipawns, from white's point of view, otherwise
+ */
+int ChessNnue_Evaluate(const ChessNnueAccumulator *accumulator, bool isWhiteTurn);
+
+
+#endif
@@ -0,0 +1,297 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ChessPgn.h"
+
+#define PGN_INITIAL_FEN     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1"
+#define PGN_LINE_LENGTH     79 // the longest movetext line, as the PGN standard asks
+#define PGN_WORD_SIZE       16 // a move number or a SAN move, with its null terminator
+
+
+typedef enum PgnTokenType {
+    PGN_TOKEN_TAG,
+    PGN_TOKEN_MOVE,
+    PGN_TOKEN_RESULT,
+    PGN_TOKEN_END,
+} PgnTokenType;
+
+struct ChessPgnReader {
+    FILE *file;
+    unsigned char buffer[CHESS_PGN_READ_BUFFER_SIZE];
+    size_t position; // of the next character in the buffer
+    size_t length; // of the buffer's valid characters
+    char token[CHESS_PGN_TOKEN_SIZE];
+    PgnTokenType pendingType; // a tag read past the end of the previous game
+    bool hasPending;
+};
+
+ChessPgnReader* ChessPgnReader_Create(FILE *file) {
+    if (!file) return NULL;
+    ChessPgnReader *reader = malloc(sizeof(ChessPgnReader));
+    if (!reader) return NULL;
+    reader->file = file;
+    reader->position = reader->length = 0;
+    reader->hasPending = false;
+    return reader;
+}
+
+ChessPgnReader* ChessPgnReader_Destroy(ChessPgnReader *reader) {
+    free(reader);
+    return NULL;
+}
+
+/**
+ * Peek at the next character of a given reader, refilling its buffer if needed.
+ * @param   reader      the reader
+ * @return  EOF at the end of the file
+ *          the next character otherwise
+ */
+int peekPgnChar(ChessPgnReader *reader) {
+    if (reader->position == reader->length) {
+        reader->length = fread(reader->buffer, 1, sizeof(reader->buffer), reader->file);
+        reader->position = 0;
+        if (!reader->length) return EOF;
+    }
+    return reader->buffer[reader->position];
+}
+
+/**
+ * Read the next character of a given reader.
+ * @param   reader      the reader
+ * @return  EOF at the end of the file
+ *          the next character otherwise
+ */
+int readPgnChar(ChessPgnReader *reader) {
+    int c = peekPgnChar(reader);
+    if (c != EOF) reader->position++;
+    return c;
+}
+
+/**
+ * Skip a given reader up to & including a given character.
+ * @param   reader      the reader
+ * @param   end         the character to skip to
+ */
+void skipPgnTo(ChessPgnReader *reader, int end) {
+    int c;
+    while ((c = readPgnChar(reader)) != EOF && c != end);
+}
+
+/**
+ * Skip a variation of a given reader, including its nested variations.
+ * @param   reader      the reader, right after the variation's '('
+ */
+void skipPgnVariation(ChessPgnReader *reader) {
+    int depth = 1, c;
+    while (depth && (c = readPgnChar(reader)) != EOF) {
+        if (c == '(') depth++;
+        if (c == ')') depth--;
+        if (c == '{') skipPgnTo(reader, '}'); // comments may have parentheses
+    }
+}
+
+/**
+ * Check whether a given token is a game result.
+ * @param   token       the token to check
+ * @return  true        if token is a game termination marker
+ *          false       otherwise
+ */
+bool isPgnResult(const char *token) {
+    return strcmp(token, "1-0") == 0 || strcmp(token, "0-1") == 0 ||
+           strcmp(token, "1/2-1/2") == 0 || strcmp(token, "*") == 0;
+}
+
+/**
+ * Read the next token of a given reader into its token buffer: a tag pair,
+ * a move or a game result, skipping comments, variations, annotations and
+ * move numbers.
+ * @param   reader      the reader - its token is set to a tag pair without
+ *                      its brackets, or to a move without its number
+ * @return  the type of the token read, PGN_TOKEN_END at the end of the file
+ */
+PgnTokenType readPgnToken(ChessPgnReader *reader) {
+    char *token = reader->token;
+    int c;
+    while ((c = readPgnChar(reader)) != EOF) {
+        if (isspace(c)) continue;
+        if (c == '{') {
+            skipPgnTo(reader, '}');
+        } else if (c == ';' || c == '%') {
+            skipPgnTo(reader, '\n');
+        } else if (c == '(') {
+            skipPgnVariation(reader);
+        } else if (c == '$') { // numeric annotation glyph
+            while ((c = peekPgnChar(reader)) != EOF && isdigit(c)) reader->position++;
+        } else if (c == '[') {
+            int length = 0;
+            bool isQuoted = false;
+            while ((c = readPgnChar(reader)) != EOF && (c != ']' || isQuoted)) {
+                if (c == '"') isQuoted = !isQuoted;
+                if (length < CHESS_PGN_TOKEN_SIZE - 1) token[length++] = c;
+            }
+            token[length] = '\0';
+            return PGN_TOKEN_TAG;
+        } else {
+            int length = 0;
+            token[length++] = c;
+            while ((c = peekPgnChar(reader)) != EOF && !isspace(c) && !strchr("{};()[$", c)) {
+                if (length < CHESS_PGN_TOKEN_SIZE - 1) token[length++] = c;
+                reader->position++;
+            }
+            token[length] = '\0';
+            if (isPgnResult(token)) return PGN_TOKEN_RESULT;
+            int start = 0;
+            while (isdigit((unsigned char)token[start])) start++;
+            if (token[start] != '.') start = 0; // not a move number, e.g. 0-0
+            while (token[start] == '.') start++;
+            if (!token[start]) continue;
+            memmove(token, token + start, strlen(token + start) + 1);
+            return PGN_TOKEN_MOVE;
+        }
+    }
+    return PGN_TOKEN_END;
+}
+
+/**
+ * Read the value of a given tag pair, if it's of a given name.
+ * @param   tag         the tag pair, e.g. FEN "8/8/8/8/8/8/8/8 w - - 0 1"
+ * @param   name        the tag name
+ * @param   value       output parameter, CHESS_PGN_TOKEN_SIZE long
+ * @return  true        if the tag is of the given name
+ *          false       otherwise
+ */
+bool readPgnTag(const char *tag, const char *name, char *value) {
+    size_t length = strlen(name);
+    if (strncmp(tag, name, length) != 0 || !isspace((unsigned char)tag[length])) return false;
+    const char *start = strchr(tag, '"');
+    if (!start) return false;
+    const char *end = strchr(++start, '"');
+    if (!end) end = start + strlen(start);
+    memcpy(value, start, end - start);
+    value[end - start] = '\0';
+    return true;
+}
+
+bool ChessPgn_ReadGame(ChessPgnReader *reader, ChessGame *game,
+                       const ChessPgnHooks *hooks, ChessPgnGameInfo *info) {
+    if (!reader || !game || !info) return false;
+    ChessGame_ResetGame(game);
+    strcpy(info->result, "*");
+    info->plies = 0;
+    info->isComplete = true;
+    bool isInGame = false, isInMoves = false, isPlaying = true;
+    char value[CHESS_PGN_TOKEN_SIZE];
+    while (true) {
+        PgnTokenType type = reader->hasPending ? reader->pendingType : readPgnToken(reader);
+        reader->hasPending = false;
+        switch (type) {
+            case PGN_TOKEN_TAG:
+                if (isInMoves) { // the next game's, as this one has no result
+                    reader->pendingType = type;
+                    reader->hasPending = true;
+                    return true;
+                }
+                isInGame = true;
+                if (readPgnTag(reader->token, "FEN", value) &&
+                    ChessGame_FromFEN(game, value) != CHESS_SUCCESS) {
+                    info->isComplete = isPlaying = false;
+                }
+                break;
+            case PGN_TOKEN_MOVE: {
+                isInGame = isInMoves = true;
+                if (!isPlaying) break;
+                ChessMove move;
+                if (ChessGame_FromSAN(game, reader->token, &move) != CHESS_SUCCESS) {
+                    info->isComplete = isPlaying = false;
+                    break;
+                }
+                if (hooks && hooks->onMove && !hooks->onMove(game, move, hooks->context)) {
+                    isPlaying = false;
+                    break;
+                }
+                ChessGame_DoMove(game, move);
+                info->plies++;
+                break;
+            }
+            case PGN_TOKEN_RESULT:
+                strcpy(info->result, reader->token);
+                return true;
+            case PGN_TOKEN_END:
+            default:
+                return isInGame;
+        }
+    }
+}
+
+/**
+ * Retrieve the PGN player name of a given player of a given ChessGame.
+ * @param   game        the game
+ * @param   color       the player
+ * @return  "Computer" for the computer's player in a 1-player game
+ *          "Human" otherwise
+ */
+const char* getPgnPlayerName(const ChessGame *game, ChessColor color) {
+    if (game->mode == CHESS_MODE_1_PLAYER && game->userColor != color) return "Computer";
+    return "Human";
+}
+
+/**
+ * Write a movetext word, wrapping the line if it would become too long.
+ * @param   file        the file to write to
+ * @param   word        the word to write
+ * @param   lineLength  the current line's length, updated
+ */
+void writePgnWord(FILE *file, const char *word, int *lineLength) {
+    int length = strlen(word);
+    if (*lineLength && *lineLength + 1 + length > PGN_LINE_LENGTH) {
+        fputc('\n', file);
+        *lineLength = 0;
+    }
+    if (*lineLength) {
+        fputc(' ', file);
+        (*lineLength)++;
+    }
+    fputs(word, file);
+    *lineLength += length;
+}
+
+bool ChessPgn_WriteGame(FILE *file, const ChessGame *game) {
+    if (!file || !game) return false;
+    ChessGame *replay = ChessGame_Copy(game);
+    if (!replay) return false;
+    const char *result = "*";
+    ChessStatus status;
+    ChessGame_GetGameStatus(replay, &status);
+    if (status == CHESS_STATUS_CHECKMATE) {
+        result = replay->turn == CHESS_PLAYER_COLOR_WHITE ? "0-1" : "1-0";
+    } else if (status == CHESS_STATUS_DRAW) {
+        result = "1/2-1/2";
+    }
+    ChessMove move;
+    while (ChessGame_UndoMove(replay, &move) == CHESS_SUCCESS);
+    char fen[CHESS_FEN_SIZE];
+    ChessGame_ToFEN(replay, fen);
+    fprintf(file, "[Event \"?\"]\n[Site \"?\"]\n[Date \"????.??.??\"]\n[Round \"?\"]\n");
+    fprintf(file, "[White \"%s\"]\n", getPgnPlayerName(game, CHESS_PLAYER_COLOR_WHITE));
+    fprintf(file, "[Black \"%s\"]\n", getPgnPlayerName(game, CHESS_PLAYER_COLOR_BLACK));
+    fprintf(file, "[Result \"%s\"]\n", result);
+    if (strcmp(fen, PGN_INITIAL_FEN) != 0) fprintf(file, "[SetUp \"1\"]\n[FEN \"%s\"]\n", fen);
+    fputc('\n', file);
+    char word[PGN_WORD_SIZE];
+    int lineLength = 0;
+    for (unsigned int i = 0; i < ChessGame_GetHistorySize(game); i++) {
+        ChessGame_GetHistoryMove(game, i, &move);
+        if (replay->turn == CHESS_PLAYER_COLOR_WHITE || i == 0) {
+            sprintf(word, replay->turn == CHESS_PLAYER_COLOR_WHITE ? "%u." : "%u...",
+                    replay->fullmoveNumber);
+            writePgnWord(file, word, &lineLength);
+        }
+        if (ChessGame_ToSAN(replay, move, word) != CHESS_SUCCESS) break; // shouldn't happen
+        writePgnWord(file, word, &lineLength);
+        ChessGame_RedoMove(replay, &move);
+    }
+    writePgnWord(file, result, &lineLength);
+    fputs("\n\n", file);
+    ChessGame_Destroy(replay);
+    return !ferror(file);
+}
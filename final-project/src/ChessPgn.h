@@ -0,0 +1,74 @@
+#ifndef CHESS_PGN_H_
+#define CHESS_PGN_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "ChessGame.h"
+
+#define CHESS_PGN_READ_BUFFER_SIZE  (1 << 16) // bytes read from the file at a time
+#define CHESS_PGN_TOKEN_SIZE        256 // longer tag pairs & moves are truncated
+#define CHESS_PGN_RESULT_SIZE       8 // "1/2-1/2", with its null terminator
+
+
+typedef struct ChessPgnReader ChessPgnReader;
+
+/**
+ * Callbacks of ChessPgn_ReadGame(), all optional.
+ */
+typedef struct ChessPgnHooks {
+    // called with each move before it's done, return false to skip the rest of the game
+    bool (*onMove)(const ChessGame *game, ChessMove move, void *context);
+    void *context;
+} ChessPgnHooks;
+
+typedef struct ChessPgnGameInfo {
+    char result[CHESS_PGN_RESULT_SIZE]; // "1-0", "0-1", "1/2-1/2" or "*", also if missing
+    unsigned int plies; // moves done
+    bool isComplete; // false if the FEN tag or a move couldn't be resolved
+} ChessPgnGameInfo;
+
+/**
+ * Create new ChessPgnReader instance, reading a given file in a single pass
+ * through a fixed-size buffer - so files of any size can be read.
+ * @param   file        the PGN file, open for reading, closed by the caller
+ * @return  NULL if file == NULL or malloc failed
+ *          ChessPgnReader* instance otherwise
+ */
+ChessPgnReader* ChessPgnReader_Create(FILE *file);
+
+/**
+ * Free all resources for a given ChessPgnReader instance.
+ * @param   reader      the instance to destroy
+ * @return  NULL
+ */
+ChessPgnReader* ChessPgnReader_Destroy(ChessPgnReader *reader);
+
+/**
+ * Read the next game of a given PGN reader, playing its moves on a given
+ * ChessGame - reset first, and set up from the game's FEN tag if it has one.
+ * Comments, variations, annotations and other tags are skipped. Once a move
+ * (or the FEN tag) can't be resolved, e.g. castling or a promotion, the rest
+ * of the game's moves are skipped, leaving the game at the last position.
+ * @param   reader      the instance to read from
+ * @param   game        the game to play the moves on, settings are kept
+ * @param   hooks       the callbacks, may be NULL
+ * @param   info        output parameter for the game's result & moves count
+ * @return  true        if a game was read
+ *          false       at the end of the file, or if an argument is NULL
+ */
+bool ChessPgn_ReadGame(ChessPgnReader *reader, ChessGame *game,
+                       const ChessPgnHooks *hooks, ChessPgnGameInfo *info);
+
+/**
+ * Write a given ChessGame as a PGN game: the seven tag roster, a FEN tag if
+ * the history doesn't start at the initial position, and the history's moves
+ * in Standard Algebraic Notation. The result is that of the current position.
+ * @param   file        the file to write to
+ * @param   game        the game to write
+ * @return  true        if the game was written
+ *          false       if an argument is NULL, malloc failed, or on an I/O error
+ */
+bool ChessPgn_WriteGame(FILE *file, const ChessGame *game);
+
+
+#endif
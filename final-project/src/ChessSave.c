@@ -0,0 +1,252 @@
+#define _POSIX_C_SOURCE 200809L // open(), fsync(), strndup()
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ChessSave.h"
+#include "ChessBitboard.h"
+
+#define SAVE_MAGIC              "CSAV"
+#define SAVE_VERSION            1
+#define SAVE_PIECES             "mrnbqkMRNBQK"
+#define SAVE_TEMP_SUFFIX        ".tmp" // of the file written before it's renamed over the save
+#define SAVE_MOVE_SQUARE_BITS   6
+#define SAVE_MOVE_SQUARE_MASK   ((1 << SAVE_MOVE_SQUARE_BITS) - 1)
+#define CRC32_POLYNOMIAL        0xedb88320 // reversed, as in zlib & PNG
+
+
+// the file layout: a SaveHeader, its moves as uint16 (from square, then to
+// square, 6 bits each from the lowest), and a uint32 CRC32 of everything before
+typedef struct SaveHeader {
+    char magic[4];
+    uint32_t version;
+    uint8_t mode;
+    uint8_t difficulty;
+    uint8_t userColor;
+    uint8_t turn;
+    uint32_t halfmoveClock;
+    uint32_t fullmoveNumber;
+    char board[CHESS_SQUARES]; // CHESS_SQUARE(x, y)
+    uint32_t moves;
+} SaveHeader;
+
+static uint32_t crcTable[256];
+static bool isCrcTableInitialized = false;
+
+/**
+ * Fill the CRC32 lookup table, once.
+ */
+void initCrcTable() {
+    if (isCrcTableInitialized) return;
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32_POLYNOMIAL : crc >> 1;
+        }
+        crcTable[i] = crc;
+    }
+    isCrcTableInitialized = true;
+}
+
+/**
+ * Compute the CRC32 of a given buffer.
+ * @param   bytes       the buffer
+ * @param   size        the buffer's size
+ * @return  the checksum
+ */
+uint32_t getCrc32(const unsigned char *bytes, size_t size) {
+    initCrcTable();
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc = crcTable[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+/**
+ * Check whether the settings & position of a given save header are valid.
+ * @param   header      the header to check
+ * @return  true        if all fields are in range, and the position is one
+ *                      ChessGame_IsValidPosition() accepts
+ *          false       otherwise, or if malloc failed
+ */
+bool isValidSaveHeader(const SaveHeader *header) {
+    if (header->mode < CHESS_MODE_1_PLAYER || header->mode > CHESS_MODE_2_PLAYER) return false;
+    if (header->difficulty < CHESS_DIFFICULTY_AMATEUR ||
+        header->difficulty > CHESS_DIFFICULTY_EXPERT) {
+        return false;
+    }
+    if (header->userColor > CHESS_PLAYER_COLOR_WHITE) return false;
+    if (header->turn > CHESS_PLAYER_COLOR_WHITE) return false;
+    for (int square = 0; square < CHESS_SQUARES; square++) {
+        char piece = header->board[square];
+        if (piece != CHESS_PIECE_NONE && (!piece || !strchr(SAVE_PIECES, piece))) return false;
+    }
+    ChessGame *position = ChessGame_Create(); // so the loaded game is untouched until valid
+    if (!position) return false;
+    for (int square = 0; square < CHESS_SQUARES; square++) {
+        CHESS_BOARD_AT(position, CHESS_SQUARE_X(square), CHESS_SQUARE_Y(square)) = header->board[square];
+    }
+    position->turn = header->turn;
+    bool isValid = ChessGame_IsValidPosition(position);
+    ChessGame_Destroy(position);
+    return isValid;
+}
+
+unsigned char* ChessSave_Encode(const ChessGame *game, size_t *size) {
+    if (!game || !size) return NULL;
+    ChessGame *start = ChessGame_Copy(game); // the position before the history
+    if (!start) return NULL;
+    ChessMove move;
+    while (ChessGame_UndoMove(start, &move) == CHESS_SUCCESS);
+    SaveHeader header = {
+        .version = SAVE_VERSION,
+        .mode = game->mode,
+        .difficulty = game->difficulty,
+        .userColor = game->userColor,
+        .turn = start->turn,
+        .halfmoveClock = start->halfmoveClock,
+        .fullmoveNumber = start->fullmoveNumber,
+        .moves = ChessGame_GetHistorySize(game),
+    };
+    memcpy(header.magic, SAVE_MAGIC, sizeof(header.magic));
+    for (int square = 0; square < CHESS_SQUARES; square++) {
+        header.board[square] = CHESS_BOARD_AT(start, CHESS_SQUARE_X(square), CHESS_SQUARE_Y(square));
+    }
+    ChessGame_Destroy(start);
+    *size = sizeof(header) + header.moves * sizeof(uint16_t) + sizeof(uint32_t);
+    unsigned char *bytes = malloc(*size);
+    if (!bytes) return NULL;
+    memcpy(bytes, &header, sizeof(header));
+    uint16_t *moves = (uint16_t *)(bytes + sizeof(header));
+    for (unsigned int i = 0; i < header.moves; i++) {
+        ChessGame_GetHistoryMove(game, i, &move);
+        moves[i] = CHESS_SQUARE(move.from.x, move.from.y) |
+                   CHESS_SQUARE(move.to.x, move.to.y) << SAVE_MOVE_SQUARE_BITS;
+    }
+    uint32_t crc = getCrc32(bytes, *size - sizeof(crc));
+    memcpy(bytes + *size - sizeof(crc), &crc, sizeof(crc));
+    return bytes;
+}
+
+/**
+ * Flush a given file's directory entries to the disk, so a rename into it
+ * survives a crash.
+ * @param   path        the file path
+ */
+void syncSaveDirectory(const char *path) {
+    const char *slash = strrchr(path, '/');
+    char *directory = slash ? strndup(path, slash == path ? 1 : (size_t)(slash - path)) : NULL;
+    int fd = open(directory ? directory : ".", O_RDONLY);
+    free(directory);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+bool ChessSave_WriteBytes(const unsigned char *bytes, size_t size, const char *path) {
+    if (!bytes || !path) return false;
+    size_t length = strlen(path);
+    char *tempPath = malloc(length + sizeof(SAVE_TEMP_SUFFIX));
+    if (!tempPath) return false;
+    memcpy(tempPath, path, length);
+    memcpy(tempPath + length, SAVE_TEMP_SUFFIX, sizeof(SAVE_TEMP_SUFFIX));
+    int fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool isWritten = fd >= 0 && write(fd, bytes, size) == (ssize_t)size && fsync(fd) == 0;
+    if (fd >= 0 && close(fd) != 0) isWritten = false;
+    if (isWritten && rename(tempPath, path) == 0) {
+        syncSaveDirectory(path);
+    } else {
+        if (fd >= 0) unlink(tempPath);
+        isWritten = false;
+    }
+    free(tempPath);
+    return isWritten;
+}
+
+bool ChessSave_Write(const ChessGame *game, const char *path) {
+    if (!game || !path) return false;
+    size_t size;
+    unsigned char *bytes = ChessSave_Encode(game, &size);
+    bool isWritten = ChessSave_WriteBytes(bytes, size, path);
+    free(bytes);
+    return isWritten;
+}
+
+ChessSaveResult ChessSave_Read(ChessGame *game, const char *path) {
+    if (!game || !path) return CHESS_SAVE_INVALID_FILE;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return CHESS_SAVE_INVALID_FILE;
+    struct stat status;
+    unsigned char *bytes = NULL;
+    size_t size = 0;
+    if (fstat(fd, &status) == 0 && (bytes = malloc(status.st_size ? status.st_size : 1))) {
+        size = status.st_size;
+        if (read(fd, bytes, size) != (ssize_t)size) {
+            free(bytes);
+            bytes = NULL;
+        }
+    }
+    close(fd);
+    if (!bytes) return CHESS_SAVE_INVALID_FILE;
+    SaveHeader header;
+    if (size < sizeof(header.magic) || memcmp(bytes, SAVE_MAGIC, sizeof(header.magic))) {
+        free(bytes);
+        return CHESS_SAVE_NOT_BINARY;
+    }
+    uint32_t crc;
+    if (size < sizeof(header) + sizeof(crc)) {
+        free(bytes);
+        return CHESS_SAVE_CORRUPTED;
+    }
+    memcpy(&header, bytes, sizeof(header));
+    memcpy(&crc, bytes + size - sizeof(crc), sizeof(crc));
+    if (header.version != SAVE_VERSION ||
+        size != sizeof(header) + (size_t)header.moves * sizeof(uint16_t) + sizeof(crc) ||
+        crc != getCrc32(bytes, size - sizeof(crc)) || !isValidSaveHeader(&header)) {
+        free(bytes);
+        return CHESS_SAVE_CORRUPTED;
+    }
+    ChessGame *loaded = ChessGame_Create(); // replayed aside, so game is untouched on failure
+    if (!loaded) {
+        free(bytes);
+        return CHESS_SAVE_INVALID_FILE;
+    }
+    for (int square = 0; square < CHESS_SQUARES; square++) {
+        CHESS_BOARD_AT(loaded, CHESS_SQUARE_X(square), CHESS_SQUARE_Y(square)) = header.board[square];
+    }
+    loaded->turn = header.turn;
+    loaded->halfmoveClock = header.halfmoveClock;
+    loaded->fullmoveNumber = header.fullmoveNumber;
+    ChessGame_RefreshState(loaded);
+    const unsigned char *moves = bytes + sizeof(header);
+    for (uint32_t i = 0; i < header.moves; i++) {
+        uint16_t encoded;
+        memcpy(&encoded, moves + i * sizeof(encoded), sizeof(encoded));
+        int from = encoded & SAVE_MOVE_SQUARE_MASK;
+        int to = (encoded >> SAVE_MOVE_SQUARE_BITS) & SAVE_MOVE_SQUARE_MASK;
+        ChessMove move = {
+            .from = { .x = CHESS_SQUARE_X(from), .y = CHESS_SQUARE_Y(from) },
+            .to = { .x = CHESS_SQUARE_X(to), .y = CHESS_SQUARE_Y(to) },
+            .capturedPiece = CHESS_PIECE_NONE,
+        };
+        if (ChessGame_DoMove(loaded, move) != CHESS_SUCCESS) {
+            ChessGame_Destroy(loaded);
+            free(bytes);
+            return CHESS_SAVE_CORRUPTED;
+        }
+    }
+    free(bytes);
+    loaded->mode = header.mode;
+    loaded->difficulty = header.difficulty;
+    loaded->userColor = header.userColor;
+    ChessGame previous = *game; // swapped, so the previous state is freed with loaded
+    *game = *loaded;
+    *loaded = previous;
+    ChessGame_Destroy(loaded);
+    return CHESS_SAVE_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#ifndef CHESS_SAVE_H_
+#define CHESS_SAVE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "ChessGame.h"
+
+
+typedef enum ChessSaveResult {
+    CHESS_SAVE_SUCCESS,
+    CHESS_SAVE_INVALID_FILE, // can't be opened or read
+    CHESS_SAVE_NOT_BINARY, // doesn't start with the binary format's magic
+    CHESS_SAVE_CORRUPTED, // unknown version, bad checksum, or invalid contents
+} ChessSaveResult;
+
+/**
+ * Encode a given ChessGame in the binary save format: a header with the
+ * settings and the position before the first move of the game's history,
+ * the history as 16-bit moves, and a CRC32 of all of it.
+ * @param   game        the instance to encode
+ * @param   size        output parameter for the encoding's size
+ * @return  NULL if game == NULL, size == NULL, or malloc failed
+ *          the encoding otherwise, to be freed by the caller
+ */
+unsigned char* ChessSave_Encode(const ChessGame *game, size_t *size);
+
+/**
+ * Write an encoded game to a given path atomically: to a temporary file
+ * next to it with a single write, synced to the disk and then renamed over
+ * the path - so the file is never left half-written, even by a crash.
+ * @param   bytes       the encoding, as of ChessSave_Encode()
+ * @param   size        the encoding's size
+ * @param   path        the file path, created or replaced
+ * @return  true        if the encoding was written
+ *          false       if bytes == NULL, path == NULL, or on an I/O error -
+ *                      the file at path is left unchanged
+ */
+bool ChessSave_WriteBytes(const unsigned char *bytes, size_t size, const char *path);
+
+/**
+ * Save a given ChessGame in the binary save format, atomically, as
+ * ChessSave_Encode() and ChessSave_WriteBytes() do.
+ * @param   game        the instance to save
+ * @param   path        the file path, created or replaced
+ * @return  true        if the game was saved
+ *          false       if game == NULL, path == NULL, malloc failed, or on an I/O error
+ */
+bool ChessSave_Write(const ChessGame *game, const char *path);
+
+/**
+ * Load a given ChessGame from a binary save file, with a single read.
+ * The history's moves are replayed, so they can be undone after loading.
+ * @param   game        the instance to load into
+ * @param   path        the file path
+ * @return  CHESS_SAVE_INVALID_FILE if game == NULL, path == NULL, the
+ *              file can't be read or malloc failed - the game is left unchanged
+ *          CHESS_SAVE_NOT_BINARY or CHESS_SAVE_CORRUPTED if the file isn't
+ *              a valid binary save, e.g. one of its moves fails to replay -
+ *              the game is left unchanged
+ *          CHESS_SAVE_SUCCESS otherwise
+ */
+ChessSaveResult ChessSave_Read(ChessGame *game, const char *path);
+
+
+#endif
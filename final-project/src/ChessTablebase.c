@@ -0,0 +1,368 @@
+#define _POSIX_C_SOURCE 200809L // mmap()
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ChessTablebase.h"
+#include "ChessBitboard.h"
+
+#define TABLEBASE_MAGIC         "CTBL"
+#define TABLEBASE_VERSION       1
+#define TABLEBASE_BLOCK_SIZE    1024 // values per compressed block
+#define TABLEBASE_MAX_RUN       256
+#define TABLEBASE_MAX_TABLES    32
+#define PIECE_ORDERS            6
+#define FLIP_SQUARE(square)     ((square) ^ (CHESS_SQUARES - CHESS_GRID)) // mirror the rows
+#define MIRROR_SQUARE(square)   ((square) ^ (CHESS_GRID - 1)) // mirror the columns
+
+
+// the file layout: a FileHeader, a TableHeader per table, and for each table
+// its uint32 block offsets (blocks + 1, relative to its data) followed by its data
+typedef struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t tables;
+    uint32_t blockSize;
+} FileHeader;
+
+typedef struct TableHeader {
+    char signature[8];
+    uint32_t pieces;
+    uint32_t blocks;
+    uint64_t offset; // of the block offsets, from the start of the file
+} TableHeader;
+
+typedef struct Table {
+    char signature[CHESS_TABLEBASE_SIGNATURE_SIZE];
+    uint32_t blocks;
+    const uint32_t *blockOffsets;
+    const uint8_t *data;
+} Table;
+
+static const char pieceLetters[PIECE_ORDERS] = { 'K', 'Q', 'R', 'B', 'N', 'P' };
+static const int pieceStrengths[PIECE_ORDERS] = { 0, 9, 5, 4, 3, 1 }; // all distinct
+
+static void *mapping = NULL;
+static size_t mappingSize = 0;
+static Table tables[TABLEBASE_MAX_TABLES];
+static int tablesCount = 0;
+
+/**
+ * Retrieve the signature order of a given ChessPiece.
+ * @param   piece       the piece
+ * @return  -1          if piece == CHESS_PIECE_NONE
+ *          the piece's index in pieceLetters otherwise
+ */
+int getPieceOrder(ChessPiece piece) {
+    switch (piece) {
+        case CHESS_PIECE_WHITE_KING: case CHESS_PIECE_BLACK_KING: return 0;
+        case CHESS_PIECE_WHITE_QUEEN: case CHESS_PIECE_BLACK_QUEEN: return 1;
+        case CHESS_PIECE_WHITE_ROOK: case CHESS_PIECE_BLACK_ROOK: return 2;
+        case CHESS_PIECE_WHITE_BISHOP: case CHESS_PIECE_BLACK_BISHOP: return 3;
+        case CHESS_PIECE_WHITE_KNIGHT: case CHESS_PIECE_BLACK_KNIGHT: return 4;
+        case CHESS_PIECE_WHITE_PAWN: case CHESS_PIECE_BLACK_PAWN: return 5;
+        case CHESS_PIECE_NONE:
+        default:
+            return -1;
+    }
+}
+
+bool ChessTablebase_GetKey(const ChessTablebasePosition *position, char *signature,
+                           uint32_t *index) {
+    if (!position || position->count < 2 || position->count > CHESS_TABLEBASE_MAX_PIECES) {
+        return false;
+    }
+    int colors[CHESS_TABLEBASE_MAX_PIECES], orders[CHESS_TABLEBASE_MAX_PIECES];
+    int squares[CHESS_TABLEBASE_MAX_PIECES];
+    int kings[2] = { 0, 0 }, strengths[2] = { 0, 0 };
+    for (int i = 0; i < position->count; i++) {
+        ChessColor color;
+        ChessGame_GetPieceColor(position->pieces[i], &color);
+        orders[i] = getPieceOrder(position->pieces[i]);
+        if (orders[i] < 0) return false;
+        colors[i] = color;
+        squares[i] = position->squares[i];
+        kings[color] += orders[i] == 0;
+        strengths[color] += pieceStrengths[orders[i]];
+    }
+    if (kings[CHESS_PLAYER_COLOR_WHITE] != 1 || kings[CHESS_PLAYER_COLOR_BLACK] != 1) return false;
+    int turn = position->turn;
+    if (strengths[CHESS_PLAYER_COLOR_BLACK] > strengths[CHESS_PLAYER_COLOR_WHITE]) {
+        for (int i = 0; i < position->count; i++) {
+            colors[i] = !colors[i];
+            squares[i] = FLIP_SQUARE(squares[i]);
+        }
+        turn = !turn;
+    }
+    int whiteKing = 0;
+    while (colors[whiteKing] != CHESS_PLAYER_COLOR_WHITE || orders[whiteKing] != 0) whiteKing++;
+    if (CHESS_SQUARE_X(squares[whiteKing]) >= CHESS_GRID / 2) {
+        for (int i = 0; i < position->count; i++) squares[i] = MIRROR_SQUARE(squares[i]);
+    }
+    // insertion sort: white first, then by piece order, then by square
+    int sorted[CHESS_TABLEBASE_MAX_PIECES];
+    for (int i = 0; i < position->count; i++) {
+        int j = i;
+        for (; j > 0; j--) {
+            int k = sorted[j - 1];
+            bool isAfter = colors[k] != colors[i] ? colors[k] < colors[i] :
+                           orders[k] != orders[i] ? orders[k] > orders[i] :
+                           squares[k] > squares[i];
+            if (!isAfter) break;
+            sorted[j] = k;
+        }
+        sorted[j] = i;
+    }
+    // the player to move is the most significant digit: white (0) or black (1)
+    uint32_t key = turn == CHESS_PLAYER_COLOR_WHITE ? 0 : 1;
+    for (int i = 0; i < position->count; i++) {
+        signature[i] = pieceLetters[orders[sorted[i]]];
+        key = key * CHESS_SQUARES + squares[sorted[i]];
+    }
+    signature[position->count] = '\0';
+    *index = key;
+    return true;
+}
+
+uint32_t ChessTablebase_GetTableSize(int pieces) {
+    uint32_t size = 2;
+    for (int i = 0; i < pieces; i++) size *= CHESS_SQUARES;
+    return size;
+}
+
+void ChessTablebase_DecodeValue(uint8_t value, ChessTablebaseResult *result) {
+    if (value == CHESS_TABLEBASE_DRAW) {
+        result->wdl = 0;
+        result->plies = 0;
+        return;
+    }
+    result->plies = value - 1;
+    result->wdl = result->plies % 2 ? 1 : -1;
+}
+
+/**
+ * Pad a given file with zeros to a 4-byte boundary.
+ * @param   file        the file to pad
+ * @return  false       if the file can't be written
+ *          true        otherwise
+ */
+bool padFile(FILE *file) {
+    long position = ftell(file);
+    if (position < 0) return false;
+    for (; position % 4; position++) {
+        if (fputc(0, file) == EOF) return false;
+    }
+    return true;
+}
+
+/**
+ * Compress and write a given table to a file.
+ * @param   file        the file to write to, at the table's block offsets
+ * @param   values      the table's values
+ * @param   size        the number of values
+ * @return  false       if the file can't be written or malloc failed
+ *          true        otherwise
+ */
+bool writeTable(FILE *file, const uint8_t *values, uint32_t size) {
+    uint32_t blocks = (size + TABLEBASE_BLOCK_SIZE - 1) / TABLEBASE_BLOCK_SIZE;
+    uint32_t *blockOffsets = malloc((blocks + 1) * sizeof(uint32_t));
+    uint8_t *data = malloc(2 * (size_t)size); // worst case: a run per value
+    bool isWritten = blockOffsets && data;
+    uint32_t dataSize = 0;
+    for (uint32_t block = 0; isWritten && block < blocks; block++) {
+        blockOffsets[block] = dataSize;
+        uint32_t end = (block + 1) * TABLEBASE_BLOCK_SIZE;
+        if (end > size) end = size;
+        for (uint32_t i = block * TABLEBASE_BLOCK_SIZE; i < end;) {
+            // a run takes the value of its first used index, and swallows unused ones
+            uint8_t value = CHESS_TABLEBASE_DRAW;
+            for (uint32_t j = i; j < end; j++) {
+                if (values[j] == CHESS_TABLEBASE_UNUSED) continue;
+                value = values[j];
+                break;
+            }
+            uint32_t run = 0;
+            while (i + run < end && run < TABLEBASE_MAX_RUN &&
+                   (values[i + run] == value || values[i + run] == CHESS_TABLEBASE_UNUSED)) {
+                run++;
+            }
+            data[dataSize++] = (uint8_t)(run - 1);
+            data[dataSize++] = value;
+            i += run;
+        }
+    }
+    if (isWritten) {
+        blockOffsets[blocks] = dataSize;
+        isWritten = fwrite(blockOffsets, sizeof(uint32_t), blocks + 1, file) == blocks + 1 &&
+                    fwrite(data, 1, dataSize, file) == dataSize;
+    }
+    free(blockOffsets);
+    free(data);
+    return isWritten;
+}
+
+bool ChessTablebase_Save(const char *path, const char **signatures,
+                         const uint8_t **values, int count) {
+    if (!path || !signatures || !values || count < 0 || count > TABLEBASE_MAX_TABLES) {
+        return false;
+    }
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+    FileHeader header = { .version = TABLEBASE_VERSION, .tables = count,
+                          .blockSize = TABLEBASE_BLOCK_SIZE };
+    memcpy(header.magic, TABLEBASE_MAGIC, sizeof(header.magic));
+    TableHeader tableHeaders[TABLEBASE_MAX_TABLES];
+    memset(tableHeaders, 0, sizeof(tableHeaders));
+    // the table headers are written again once their offsets are known
+    bool isSaved = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(tableHeaders, sizeof(TableHeader), count, file) == (size_t)count;
+    for (int i = 0; isSaved && i < count; i++) {
+        int pieces = strlen(signatures[i]);
+        if (pieces < 2 || pieces > CHESS_TABLEBASE_MAX_PIECES) {
+            isSaved = false;
+            break;
+        }
+        uint32_t size = ChessTablebase_GetTableSize(pieces);
+        memcpy(tableHeaders[i].signature, signatures[i], pieces);
+        tableHeaders[i].pieces = pieces;
+        tableHeaders[i].blocks = (size + TABLEBASE_BLOCK_SIZE - 1) / TABLEBASE_BLOCK_SIZE;
+        isSaved = padFile(file);
+        tableHeaders[i].offset = ftell(file);
+        isSaved = isSaved && writeTable(file, values[i], size);
+    }
+    isSaved = isSaved && fseek(file, sizeof(header), SEEK_SET) == 0 &&
+              fwrite(tableHeaders, sizeof(TableHeader), count, file) == (size_t)count;
+    return fclose(file) == 0 && isSaved;
+}
+
+/**
+ * Check and register the tables of the mapped file.
+ * @return  true        if the file is a valid tablebase
+ *          false       otherwise
+ */
+bool readTables() {
+    const uint8_t *bytes = mapping;
+    const FileHeader *header = mapping;
+    if (mappingSize < sizeof(FileHeader)) return false;
+    if (memcmp(header->magic, TABLEBASE_MAGIC, sizeof(header->magic))) return false;
+    if (header->version != TABLEBASE_VERSION || header->blockSize != TABLEBASE_BLOCK_SIZE) {
+        return false;
+    }
+    if (header->tables > TABLEBASE_MAX_TABLES) return false;
+    if (mappingSize < sizeof(FileHeader) + header->tables * sizeof(TableHeader)) return false;
+    const TableHeader *tableHeaders = (const TableHeader *)(header + 1);
+    for (uint32_t i = 0; i < header->tables; i++) {
+        const TableHeader *tableHeader = &tableHeaders[i];
+        if (tableHeader->pieces < 2 || tableHeader->pieces > CHESS_TABLEBASE_MAX_PIECES) {
+            return false;
+        }
+        uint32_t size = ChessTablebase_GetTableSize(tableHeader->pieces);
+        uint64_t dataOffset = tableHeader->offset + (tableHeader->blocks + 1) * sizeof(uint32_t);
+        if (tableHeader->blocks != (size + TABLEBASE_BLOCK_SIZE - 1) / TABLEBASE_BLOCK_SIZE ||
+            tableHeader->offset % sizeof(uint32_t) || dataOffset > mappingSize) {
+            return false;
+        }
+        Table *table = &tables[i];
+        memcpy(table->signature, tableHeader->signature, tableHeader->pieces);
+        table->signature[tableHeader->pieces] = '\0';
+        table->blocks = tableHeader->blocks;
+        table->blockOffsets = (const uint32_t *)(bytes + tableHeader->offset);
+        table->data = bytes + dataOffset;
+        if (dataOffset + table->blockOffsets[table->blocks] > mappingSize) return false;
+        // trusted by getTableValue(): ordered, up to the last one, and of whole runs
+        for (uint32_t block = 0; block < table->blocks; block++) {
+            uint32_t start = table->blockOffsets[block], end = table->blockOffsets[block + 1];
+            if (start > end || (end - start) % 2) return false;
+        }
+    }
+    tablesCount = header->tables;
+    return true;
+}
+
+bool ChessTablebase_Load(const char *path) {
+    ChessTablebase_Unload();
+    if (!path) return false;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0) {
+        mappingSize = status.st_size;
+        mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) mapping = NULL;
+    }
+    close(fd); // the mapping stays valid
+    if (!mapping || !readTables()) {
+        ChessTablebase_Unload();
+        return false;
+    }
+    return true;
+}
+
+void ChessTablebase_Unload() {
+    if (mapping) munmap(mapping, mappingSize);
+    mapping = NULL;
+    mappingSize = 0;
+    tablesCount = 0;
+}
+
+bool ChessTablebase_IsLoaded() {
+    return tablesCount > 0;
+}
+
+/**
+ * Decode the value at a given index of a given table.
+ * Only the index's block is decoded, so the cost is bounded by the block size.
+ * @param   table       the table
+ * @param   index       the index, within the table
+ * @param   value       output parameter for the value
+ * @return  true        if the value was found
+ *          false       if the index's block is malformed, its runs too short
+ */
+bool getTableValue(const Table *table, uint32_t index, uint8_t *value) {
+    uint32_t block = index / TABLEBASE_BLOCK_SIZE, offset = index % TABLEBASE_BLOCK_SIZE;
+    const uint8_t *run = table->data + table->blockOffsets[block];
+    const uint8_t *end = table->data + table->blockOffsets[block + 1];
+    for (; run < end; run += 2) {
+        uint32_t length = run[0] + 1u;
+        if (offset < length) {
+            *value = run[1];
+            return true;
+        }
+        offset -= length;
+    }
+    return false;
+}
+
+bool ChessTablebase_ProbePosition(const ChessTablebasePosition *position,
+                                  ChessTablebaseResult *result) {
+    char signature[CHESS_TABLEBASE_SIGNATURE_SIZE];
+    uint32_t index;
+    if (!tablesCount || !ChessTablebase_GetKey(position, signature, &index)) return false;
+    for (int i = 0; i < tablesCount; i++) {
+        if (strcmp(tables[i].signature, signature) != 0) continue;
+        uint8_t value;
+        if (index / TABLEBASE_BLOCK_SIZE >= tables[i].blocks) return false;
+        if (!getTableValue(&tables[i], index, &value)) return false;
+        ChessTablebase_DecodeValue(value, result);
+        return true;
+    }
+    return false;
+}
+
+bool ChessTablebase_Probe(const ChessGame *game, ChessTablebaseResult *result) {
+    if (!game || !tablesCount) return false;
+    ChessBitboard occupied = game->occupancy[CHESS_PLAYER_COLOR_BLACK] |
+                             game->occupancy[CHESS_PLAYER_COLOR_WHITE];
+    if (ChessBitboard_Count(occupied) > CHESS_TABLEBASE_MAX_PIECES) return false;
+    ChessTablebasePosition position = { .count = 0, .turn = game->turn };
+    while (occupied) {
+        int square = ChessBitboard_PopSquare(&occupied);
+        position.pieces[position.count] = CHESS_BOARD_AT(game, CHESS_SQUARE_X(square), CHESS_SQUARE_Y(square));
+        position.squares[position.count++] = square;
+    }
+    return ChessTablebase_ProbePosition(&position, result);
+}
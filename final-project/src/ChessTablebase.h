@@ -0,0 +1,125 @@
+#ifndef CHESS_TABLEBASE_H_
+#define CHESS_TABLEBASE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ChessGame.h"
+
+#define CHESS_TABLEBASE_MAX_PIECES      4
+#define CHESS_TABLEBASE_SIGNATURE_SIZE  (CHESS_TABLEBASE_MAX_PIECES + 1)
+#define CHESS_TABLEBASE_DRAW            0
+#define CHESS_TABLEBASE_UNUSED          255 // an index no position maps to
+#define CHESS_TABLEBASE_MAX_PLIES       253
+
+
+/**
+ * An endgame position, as a list of its pieces.
+ * A table's values are indexed by the position's player to move and its
+ * pieces' squares, in the order of the table's signature - e.g. "KQKR".
+ * Each value is CHESS_TABLEBASE_DRAW, or the number of plies to mate + 1,
+ * which is even for a win and odd for a loss of the player to move.
+ * Illegal positions, and the duplicates ChessTablebase_GetKey() never
+ * returns, are CHESS_TABLEBASE_UNUSED.
+ */
+typedef struct ChessTablebasePosition {
+    int count;
+    ChessPiece pieces[CHESS_TABLEBASE_MAX_PIECES];
+    int squares[CHESS_TABLEBASE_MAX_PIECES]; // CHESS_SQUARE(x, y)
+    ChessColor turn;
+} ChessTablebasePosition;
+
+typedef struct ChessTablebaseResult {
+    int wdl; // 1 - win, 0 - draw, -1 - loss, for the player to move
+    int plies; // to mate, 0 for a draw
+} ChessTablebaseResult;
+
+/**
+ * Compute the table signature and index of a given position.
+ * The stronger player's pieces always come first, so a position where
+ * black is stronger is looked up with its colors swapped and its board
+ * flipped. Pieces are ordered king, queen, rook, bishop, knight, pawn,
+ * identical pieces by square. Without castling the board is symmetric
+ * left to right, so it's mirrored to keep the first king on files A-D.
+ * @param   position    the position to index
+ * @param   signature   output parameter, CHESS_TABLEBASE_SIGNATURE_SIZE long
+ * @param   index       output parameter for the position's index in the table
+ * @return  true        if the position has one king per player and at most
+ *                      CHESS_TABLEBASE_MAX_PIECES pieces
+ *          false       otherwise
+ */
+bool ChessTablebase_GetKey(const ChessTablebasePosition *position, char *signature,
+                           uint32_t *index);
+
+/**
+ * Retrieve the number of values in a table with a given number of pieces.
+ * @param   pieces      the number of pieces
+ * @return  the number of values: 2 players to move * 64 squares per piece
+ */
+uint32_t ChessTablebase_GetTableSize(int pieces);
+
+/**
+ * Decode a table value.
+ * @param   value       the value to decode
+ * @param   result      output parameter for the decoded result
+ */
+void ChessTablebase_DecodeValue(uint8_t value, ChessTablebaseResult *result);
+
+/**
+ * Write given tables to a tablebase file.
+ * Each table is compressed in fixed-size blocks of run-length encoded values,
+ * with an offset per block so a probe only decodes a single block.
+ * CHESS_TABLEBASE_UNUSED values are merged into the runs around them.
+ * @param   path        the tablebase file path
+ * @param   signatures  the tables' signatures
+ * @param   values      the tables' values, ChessTablebase_GetTableSize() each
+ * @param   count       the number of tables
+ * @return  true        if the file was written
+ *          false       otherwise
+ */
+bool ChessTablebase_Save(const char *path, const char **signatures,
+                         const uint8_t **values, int count);
+
+/**
+ * Memory-map a tablebase file written by ChessTablebase_Save(), replacing
+ * any loaded tablebase.
+ * @param   path        the tablebase file path
+ * @return  true        if the tablebase was loaded
+ *          false       if the file can't be mapped or is malformed
+ */
+bool ChessTablebase_Load(const char *path);
+
+/**
+ * Unmap the tablebase, if loaded.
+ */
+void ChessTablebase_Unload();
+
+/**
+ * Signal if a tablebase is loaded.
+ * @return  true        if a tablebase is loaded
+ *          false       otherwise
+ */
+bool ChessTablebase_IsLoaded();
+
+/**
+ * Look up a given position in the tablebase.
+ * @param   position    the position to look up
+ * @param   result      output parameter for the result, won't change on a miss
+ * @return  true        if the position's table is loaded
+ *          false       otherwise, or if its value can't be decoded
+ */
+bool ChessTablebase_ProbePosition(const ChessTablebasePosition *position,
+                                  ChessTablebaseResult *result);
+
+/**
+ * Look up the position of a given ChessGame in the tablebase.
+ * Positions with more than CHESS_TABLEBASE_MAX_PIECES pieces are rejected
+ * in constant time, so it's cheap to call at every search node.
+ * @param   game        the game to look up
+ * @param   result      output parameter for the result, won't change on a miss
+ * @return  true        if the position's table is loaded
+ *          false       otherwise, or if its value can't be decoded
+ */
+bool ChessTablebase_Probe(const ChessGame *game, ChessTablebaseResult *result);
+
+
+#endif
@@ -300,7 +300,7 @@ void onClickUserColorBlackButton(void *args) {
 
 void onPreRenderUndoButton(Button *button, const void *args) {
     GameManager *manager = (GameManager*)args;
-    Button_SetEnabled(button, !ArrayStack_IsEmpty(manager->game->history));
+    Button_SetEnabled(button, ChessGame_GetHistorySize(manager->game) > 0);
 }
 
 void onClickUndoButton(void *args) {
@@ -240,7 +240,7 @@ void Board_Render(Board *board, const GameManager *manager, GameCommandType comm
         for (int j = 0; j < CHESS_GRID; j++) {
             if (manager) {
                 Button_SetImage(board->buttons[i][j],
-                            pieceToSrcImage(manager->game->board[i][CHESS_GRID - 1 - j]));
+                            pieceToSrcImage(CHESS_BOARD_AT(manager->game, i, CHESS_GRID - 1 - j)));
             }
             Button_Render(board->buttons[i][j], NULL);
         }
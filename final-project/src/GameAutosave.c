@@ -0,0 +1,96 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GameAutosave.h"
+#include "ChessSave.h"
+
+
+struct GameAutosave {
+    char *path;
+    pthread_t thread;
+    bool isRunning; // the thread was started
+    // shared with the thread
+    pthread_mutex_t lock; // guards all of the below
+    pthread_cond_t hasSnapshot;
+    unsigned char *snapshot; // the latest one not written yet, or NULL
+    size_t size;
+    bool isStopping;
+};
+
+/**
+ * Write the snapshots of a given GameAutosave instance as they come, until
+ * it's stopped and the last one is written.
+ * @param   argument    the GameAutosave
+ * @return  NULL
+ */
+void* runAutosave(void *argument) {
+    GameAutosave *autosave = argument;
+    pthread_mutex_lock(&autosave->lock);
+    while (true) {
+        while (!autosave->snapshot && !autosave->isStopping) {
+            pthread_cond_wait(&autosave->hasSnapshot, &autosave->lock);
+        }
+        if (!autosave->snapshot) break;
+        unsigned char *snapshot = autosave->snapshot;
+        size_t size = autosave->size;
+        autosave->snapshot = NULL;
+        pthread_mutex_unlock(&autosave->lock);
+        ChessSave_WriteBytes(snapshot, size, autosave->path); // on failure, the last save is kept
+        free(snapshot);
+        pthread_mutex_lock(&autosave->lock);
+    }
+    pthread_mutex_unlock(&autosave->lock);
+    return NULL;
+}
+
+GameAutosave* GameAutosave_Create(const char *path) {
+    if (!path) return NULL;
+    GameAutosave *autosave = malloc(sizeof(GameAutosave));
+    if (!autosave) return NULL;
+    autosave->path = malloc(strlen(path) + 1);
+    if (!autosave->path) {
+        free(autosave);
+        return NULL;
+    }
+    strcpy(autosave->path, path);
+    autosave->snapshot = NULL;
+    autosave->isStopping = false;
+    pthread_mutex_init(&autosave->lock, NULL);
+    pthread_cond_init(&autosave->hasSnapshot, NULL);
+    autosave->isRunning = pthread_create(&autosave->thread, NULL, runAutosave, autosave) == 0;
+    return autosave;
+}
+
+GameAutosave* GameAutosave_Destroy(GameAutosave *autosave) {
+    if (!autosave) return NULL;
+    if (autosave->isRunning) {
+        pthread_mutex_lock(&autosave->lock);
+        autosave->isStopping = true;
+        pthread_cond_signal(&autosave->hasSnapshot);
+        pthread_mutex_unlock(&autosave->lock);
+        pthread_join(autosave->thread, NULL);
+    }
+    pthread_mutex_destroy(&autosave->lock);
+    pthread_cond_destroy(&autosave->hasSnapshot);
+    free(autosave->path);
+    free(autosave);
+    return NULL;
+}
+
+void GameAutosave_Submit(GameAutosave *autosave, const ChessGame *game) {
+    if (!autosave || !game) return;
+    size_t size;
+    unsigned char *snapshot = ChessSave_Encode(game, &size);
+    if (!snapshot) return;
+    if (!autosave->isRunning) {
+        ChessSave_WriteBytes(snapshot, size, autosave->path);
+        free(snapshot);
+        return;
+    }
+    pthread_mutex_lock(&autosave->lock);
+    free(autosave->snapshot); // superseded before it was written
+    autosave->snapshot = snapshot;
+    autosave->size = size;
+    pthread_cond_signal(&autosave->hasSnapshot);
+    pthread_mutex_unlock(&autosave->lock);
+}
@@ -0,0 +1,38 @@
+#ifndef GAME_AUTOSAVE_H_
+#define GAME_AUTOSAVE_H_
+
+#include <stdbool.h>
+#include "ChessGame.h"
+
+
+typedef struct GameAutosave GameAutosave;
+
+/**
+ * Create new GameAutosave instance, saving games to a given path in the
+ * binary save format on a background thread of its own.
+ * @param   path        the file path, replaced atomically by each save
+ * @return  NULL if path == NULL or malloc failed
+ *          GameAutosave* instance otherwise
+ */
+GameAutosave* GameAutosave_Create(const char *path);
+
+/**
+ * Free all resources for a given GameAutosave instance, once its last
+ * snapshot is written.
+ * @param   autosave    the instance to destroy
+ * @return  NULL
+ */
+GameAutosave* GameAutosave_Destroy(GameAutosave *autosave);
+
+/**
+ * Snapshot a given ChessGame to be saved by a given GameAutosave instance.
+ * Only the game is encoded here, in memory - it's written by the background
+ * thread, which skips snapshots superseded before their turn came.
+ * The snapshot is written at once if the thread couldn't be started.
+ * @param   autosave    the instance to use
+ * @param   game        the game to save
+ */
+void GameAutosave_Submit(GameAutosave *autosave, const ChessGame *game);
+
+
+#endif
@@ -3,8 +3,14 @@
 #include <string.h>
 #include "GameManager.h"
 #include "ArrayStack.h"
+#include "ChessBook.h"
+#include "ChessEval.h"
+#include "ChessPgn.h"
+#include "ChessSave.h"
+#include "ChessTablebase.h"
 
 #define LINE_MAX_LENGTH 64
+#define SEARCH_POLL_NODES 256 // between checks of GameSearchHooks.isStopped & maxNodes
 #define ALPHA INT_MIN
 #define BETA INT_MAX
 
@@ -42,7 +48,7 @@ ChessDifficulty difficultyStrToChessDifficulty(const char *difficulty) {
 }
 
 char* chessPieceLocationToStr(ChessGame *game, int x, int y){
-    switch (game->board[x][y]){
+    switch (CHESS_BOARD_AT(game, x, y)){
         case CHESS_PIECE_WHITE_PAWN:
         case CHESS_PIECE_BLACK_PAWN:
             return "pawn";
@@ -67,7 +73,7 @@ char* chessPieceLocationToStr(ChessGame *game, int x, int y){
     }
 }
 
-void handleLoadGame(GameManager *manager, const char *path) {
+void handleLoadTextGame(GameManager *manager, const char *path) {
     FILE *fp = fopen(path, "r");
     if (!fp) {
         manager->error = GAME_ERROR_INVALID_FILE;
@@ -93,11 +99,48 @@ void handleLoadGame(GameManager *manager, const char *path) {
         fgets(line, LINE_MAX_LENGTH, fp);
         strtok(line, " \n");
         for (int j = 0; j < CHESS_GRID; j++) {
-            manager->game->board[j][i] = *strtok(NULL, " \n");
+            CHESS_BOARD_AT(manager->game, j, i) = *strtok(NULL, " \n");
         }
     }
     fclose(fp);
+    ChessGame_RefreshState(manager->game);
+
+}
+
+bool isPgnPath(const char *path) {
+    size_t length = strlen(path);
+    return length >= 4 && strcmp(path + length - 4, ".pgn") == 0;
+}
 
+void handleLoadPgnGame(GameManager *manager, const char *path) {
+    FILE *fp = fopen(path, "r");
+    ChessPgnReader *reader = ChessPgnReader_Create(fp);
+    ChessPgnGameInfo info;
+    if (!reader || !ChessPgn_ReadGame(reader, manager->game, NULL, &info) || !info.isComplete) {
+        ChessGame_ResetGame(manager->game);
+        manager->error = GAME_ERROR_INVALID_FILE;
+    }
+    ChessPgnReader_Destroy(reader);
+    if (fp) fclose(fp);
+}
+
+void handleLoadGame(GameManager *manager, const char *path) {
+    switch (ChessSave_Read(manager->game, path)) {
+        case CHESS_SAVE_SUCCESS:
+            break;
+        case CHESS_SAVE_NOT_BINARY: // a game exported as PGN or as text
+            if (isPgnPath(path)) {
+                handleLoadPgnGame(manager, path);
+            } else {
+                handleLoadTextGame(manager, path);
+            }
+            break;
+        case CHESS_SAVE_INVALID_FILE:
+        case CHESS_SAVE_CORRUPTED:
+        default:
+            manager->error = GAME_ERROR_INVALID_FILE;
+            break;
+    }
 }
 
 void processSettingsCommand(GameManager *manager, GameCommand command) {
@@ -130,14 +173,18 @@ void processSettingsCommand(GameManager *manager, GameCommand command) {
         case GAME_COMMAND_LOAD_GAME:
             handleLoadGame(manager, command.path);
             break;
+        case GAME_COMMAND_POSITION:
+            res = ChessGame_FromFEN(manager->game, command.path);
+            if (res == CHESS_INVALID_ARGUMENT)
+                manager->error = GAME_ERROR_INVALID_FEN;
+            break;
         case GAME_COMMAND_DEFAULT_SETTINGS:
             ChessGame_SetDefaultSettings(manager->game);
             break;
         case GAME_COMMAND_PRINT_SETTINGS:
             // done in CLIEngine
             break;
-        case GAME_COMMAND_START:
-            ChessGame_InitBoard(manager->game);
+        case GAME_COMMAND_START: // the board was set up by create, reset, load or position
             manager->phase = GAME_PHASE_RUNNING;
             break;
         case GAME_COMMAND_QUIT:
@@ -211,17 +258,28 @@ void handleGetMoves(GameManager *manager, GameCommand command) {
 }
 
 void handleSaveGame(GameManager *manager, const char *path) {
+    if (!ChessSave_Write(manager->game, path)) {
+        manager->error = GAME_ERROR_FILE_ALLOC;
+        return;
+    }
+    manager->isSaved = true;
+}
+
+void handleExportGame(GameManager *manager, const char *path) {
     FILE *fp = fopen(path, "w+");
     if (!fp) {
         manager->error = GAME_ERROR_FILE_ALLOC;
         return;
     }
-    fputs(ChessColorToString[manager->game->turn].string, fp);
-    fputs("\n", fp);
-    GameManager_SettingsToStream(manager, fp);
-    GameManager_BoardToStream(manager, fp);
+    if (isPgnPath(path)) {
+        if (!ChessPgn_WriteGame(fp, manager->game)) manager->error = GAME_ERROR_FILE_ALLOC;
+    } else {
+        fputs(ChessColorToString[manager->game->turn].string, fp);
+        fputs("\n", fp);
+        GameManager_SettingsToStream(manager, fp);
+        GameManager_BoardToStream(manager, fp);
+    }
     fclose(fp);
-    manager->isSaved = true;
 }
 
 void handleUndoMove(GameManager *manager) {
@@ -255,6 +313,9 @@ void processRunningCommand(GameManager *manager, GameCommand command) {
         case GAME_COMMAND_SAVE:
             handleSaveGame(manager, command.path);
             break;
+        case GAME_COMMAND_EXPORT:
+            handleExportGame(manager, command.path);
+            break;
         case GAME_COMMAND_UNDO:
             handleUndoMove(manager);
             break;
@@ -279,11 +340,14 @@ void processRunningCommand(GameManager *manager, GameCommand command) {
 GameManager* GameManager_Create() {
     GameManager *manager = malloc(sizeof(GameManager));
     if (!manager) return GameManager_Destroy(manager);
+    manager->autosave = NULL;
     manager->game = ChessGame_Create();
     if (!manager->game) return GameManager_Destroy(manager);
+    ChessGame_InitBoard(manager->game);
     manager->phase = GAME_PHASE_SETTINGS;
     manager->error = GAME_ERROR_NONE;
     manager->moves = NULL;
+    memset(&manager->stats, 0, sizeof(manager->stats));
     manager->isSaved = false;
     manager->paneType = GAME_PANE_TYPE_MAIN;
     manager->slot = 1;
@@ -292,12 +356,20 @@ GameManager* GameManager_Create() {
 
 GameManager* GameManager_Destroy(GameManager *manager) {
     if (!manager) return NULL;
+    GameAutosave_Destroy(manager->autosave); // before the game, as a save may be pending
     if (manager->game) ChessGame_Destroy(manager->game);
     if (manager->moves) ArrayStack_Destroy(manager->moves);
     free(manager);
     return NULL;
 }
 
+bool GameManager_SetAutosave(GameManager *manager, const char *path) {
+    if (!manager || !path) return false;
+    GameAutosave_Destroy(manager->autosave);
+    manager->autosave = GameAutosave_Create(path);
+    return manager->autosave != NULL;
+}
+
 GamePlayerType GameManager_GetCurrentPlayerType(GameManager *manager) {
     if (!manager) return -1;
     bool isOtherPlayer = manager->game->turn != manager->game->userColor;
@@ -307,95 +379,156 @@ GamePlayerType GameManager_GetCurrentPlayerType(GameManager *manager) {
            : GAME_PLAYER_TYPE_HUMAN;
 }
 
-int getPieceScore(ChessPiece piece) {
-    switch (piece) {
-        case CHESS_PIECE_WHITE_PAWN:
-            return 1;
-        case CHESS_PIECE_BLACK_PAWN:
-            return -1;
-        case CHESS_PIECE_WHITE_KNIGHT:
-        case CHESS_PIECE_WHITE_BISHOP:
-            return 3;
-        case CHESS_PIECE_BLACK_KNIGHT:
-        case CHESS_PIECE_BLACK_BISHOP:
-            return -3;
-        case CHESS_PIECE_WHITE_ROOK:
-            return 5;
-        case CHESS_PIECE_BLACK_ROOK:
-            return -5;
-        case CHESS_PIECE_WHITE_QUEEN:
-            return 9;
-        case CHESS_PIECE_BLACK_QUEEN:
-            return -9;
-        case CHESS_PIECE_WHITE_KING:
-            return 100;
-        case CHESS_PIECE_BLACK_KING:
-            return -100;
-        case CHESS_PIECE_NONE:
-        default:
-            return 0;
-    }
-}
+/**
+ * The state of a single search, shared by all of its minimax nodes.
+ */
+typedef struct Search {
+    GameSearchStats stats;
+    ChessEvalStats evalStats; // of this search only, as searches may run on several threads
+    const GameSearchHooks *hooks; // NULL for a search that can't be stopped
+    bool isStopped; // once set, the nodes return at once with meaningless scores
+} Search;
 
-int getBoardScore(ChessGame *game) {
+int getBoardScore(ChessGame *game, int alpha, int beta, Search *search) {
+    int score;
+    // the game status is part of the cached score, but the fifty-move clock isn't hashed
+    bool isCacheable = game->halfmoveClock < CHESS_FIFTY_MOVE_LIMIT;
+    if (isCacheable && ChessEval_ProbeCache(game->hash, &score, &search->evalStats)) return score;
     ChessStatus status;
     ChessGame_GetGameStatus(game, &status);
     switch (status) {
         case CHESS_STATUS_DRAW:
-            return 0;
-        case CHESS_STATUS_CHECKMATE:
-            return 1000;
+            score = 0;
+            break;
+        case CHESS_STATUS_CHECKMATE: // the player to move is the one who lost
+            score = game->turn == CHESS_PLAYER_COLOR_WHITE
+                ? -CHESS_EVAL_CHECKMATE_SCORE
+                : CHESS_EVAL_CHECKMATE_SCORE;
+            break;
         default:
+            if (ChessNnue_IsLoaded()) {
+                score = ChessNnue_Evaluate(&game->accumulator,
+                                           game->turn == CHESS_PLAYER_COLOR_WHITE);
+            } else {
+                bool isExact;
+                score = ChessEval_EvaluateLazy(game, alpha, beta, &isExact, &search->evalStats);
+                if (!isExact) return score; // only a bound, not worth caching
+            }
             break;
     }
-    int score = 0;
-    for (int i = 0; i < CHESS_GRID; i++) {
-        for (int j = 0; j < CHESS_GRID; j++) {
-            score += getPieceScore(game->board[i][j]);
-        }
-    }
+    if (isCacheable) ChessEval_StoreCache(game->hash, score);
     return score;
 }
 
-int minimax(ChessGame *game, int depth, int alpha, int beta, ChessMove *bestMove) {
-    if (depth == 0) return getBoardScore(game);
+/**
+ * Look up the exact score of a given position in the endgame tablebase.
+ * Wins are scored just below a checkmate, quicker mates higher.
+ * @param   game        the game to look up
+ * @param   score       output parameter, from white's point of view
+ * @return  true        if the position is in a loaded table
+ *          false       otherwise
+ */
+bool getTablebaseScore(ChessGame *game, int *score) {
+    ChessTablebaseResult result;
+    if (!ChessTablebase_Probe(game, &result)) return false;
+    *score = result.wdl * (CHESS_EVAL_CHECKMATE_SCORE - 1 - result.plies);
+    if (game->turn == CHESS_PLAYER_COLOR_BLACK) *score = -*score;
+    return true;
+}
+
+/**
+ * Check whether a given position reached during the search is a draw by rule,
+ * so its subtree doesn't need to be searched.
+ * @param   game        the game to check
+ * @return  true        if the position is a repetition of a position in
+ *                      the game / search path, the fifty-move limit is reached,
+ *                      or no player has the material left to checkmate
+ *          false       otherwise
+ */
+bool isSearchDraw(ChessGame *game) {
+    return game->halfmoveClock >= CHESS_FIFTY_MOVE_LIMIT || ChessGame_IsRepetition(game) ||
+           ChessEval_IsDeadDraw(game);
+}
+
+int minimax(ChessGame *game, int depth, int alpha, int beta,
+            ChessPackedMove *bestMove, Search *search) {
+    search->stats.nodes++;
+    if (search->hooks && search->stats.nodes % SEARCH_POLL_NODES == 0 &&
+        ((search->hooks->maxNodes && search->stats.nodes >= search->hooks->maxNodes) ||
+         (search->hooks->isStopped && search->hooks->isStopped(search->hooks->context)))) {
+        search->isStopped = true;
+    }
+    if (search->isStopped) return 0;
+    if (depth == 0) return getBoardScore(game, alpha, beta, search);
+    ChessPackedMove moves[CHESS_MAX_MOVES];
+    unsigned int movesCount = ChessGame_GetAllMoves(game, moves);
+    // checkmate or stalemate, rather than the bound of the window
+    if (!movesCount) return getBoardScore(game, alpha, beta, search);
     int moveScore;
-    ChessMove move;
-    ChessMove tempMove; // only here as a garbage pointer - need to find a better way
-    ChessColor color;
-    ArrayStack *positions = NULL;
-    for (int i = 0; i < CHESS_GRID; i++) {
-        for (int j = 0; j < CHESS_GRID; j++) {
-            move.from = (ChessPos){ .x = i, .y = j };
-            ChessGame_GetPieceColor(game->board[i][j], &color);
-            if (color != game->turn) continue;
-            ChessGame *gameCopy = ChessGame_Copy(game);
-            ChessGame_GetMoves(gameCopy, move.from, &positions);
-            while (!ArrayStack_IsEmpty(positions)) {
-                move.to = *(ChessPos *)ArrayStack_PopLeft(positions);
-                ChessGame_DoMove(gameCopy, move);
-                moveScore = minimax(gameCopy, depth - 1, alpha, beta, &tempMove);
-                if (game->turn == CHESS_PLAYER_COLOR_WHITE && moveScore > alpha) {
-                    alpha = moveScore;
-                    memcpy(bestMove, &move, sizeof(ChessMove));
-                } else if (game->turn == CHESS_PLAYER_COLOR_BLACK && moveScore < beta) {
-                    beta = moveScore;
-                    memcpy(bestMove, &move, sizeof(ChessMove));
-                }
-                ChessGame_UndoMove(gameCopy, &move);
-                if (beta < alpha) break; // pruning
-            }
-            ChessGame_Destroy(gameCopy);
+    ChessPackedMove childMove; // only here as a garbage pointer
+    for (unsigned int i = 0; i < movesCount; i++) {
+        ChessMove move = ChessGame_UnpackMove(moves[i]);
+        ChessGame_DoMove(game, move); // searched in place, undone below
+        if (isSearchDraw(game)) {
+            moveScore = 0;
+        } else if (getTablebaseScore(game, &moveScore)) {
+            search->stats.tablebaseHits++;
+        } else {
+            moveScore = minimax(game, depth - 1, alpha, beta, &childMove, search);
+        }
+        ChessGame_UndoMove(game, &move);
+        if (search->isStopped) break;
+        if (game->turn == CHESS_PLAYER_COLOR_WHITE && moveScore > alpha) {
+            alpha = moveScore;
+            *bestMove = moves[i];
+        } else if (game->turn == CHESS_PLAYER_COLOR_BLACK && moveScore < beta) {
+            beta = moveScore;
+            *bestMove = moves[i];
+        }
+        if (beta < alpha) { // pruning, of the moving piece's other moves
+            while (i + 1 < movesCount && CHESS_MOVE_FROM(moves[i + 1]) == CHESS_MOVE_FROM(moves[i])) i++;
         }
     }
-    ArrayStack_Destroy(positions);
     return game->turn == CHESS_PLAYER_COLOR_WHITE ? alpha : beta;
 }
 
-GameCommand GameManager_GetAIMove(GameManager *manager) {
+/**
+ * Copy a given search's statistics, with its evaluation counters.
+ * @param   search      the search to copy the statistics of
+ * @param   stats       the statistics to copy into
+ */
+void getSearchStats(const Search *search, GameSearchStats *stats) {
+    *stats = search->stats;
+    stats->evalProbes = search->evalStats.evalProbes;
+    stats->evalHits = search->evalStats.evalHits;
+    stats->lazyExits = search->evalStats.lazyExits;
+    stats->pawnProbes = search->evalStats.pawnProbes;
+    stats->pawnHits = search->evalStats.pawnHits;
+}
+
+GameCommand GameManager_GetAIMove(GameManager *manager, const GameSearchHooks *hooks) {
     GameCommand command = { .type = GAME_COMMAND_MOVE };
     ChessMove move;
-    minimax(manager->game, manager->game->difficulty, ALPHA, BETA, &move);
+    memset(&manager->stats, 0, sizeof(manager->stats));
+    if (!ChessBook_Probe(manager->game, &move)) {
+        Search search = { .hooks = NULL, .isStopped = false };
+        memset(&search.stats, 0, sizeof(search.stats));
+        memset(&search.evalStats, 0, sizeof(search.evalStats));
+        ChessPackedMove bestMove = CHESS_MOVE_NONE;
+        ChessGame *searchGame = ChessGame_Copy(manager->game); // searched in place
+        if (searchGame) {
+            if (hooks) { // a move to play once stopped
+                minimax(searchGame, 1, ALPHA, BETA, &bestMove, &search);
+                search.hooks = hooks;
+            }
+            ChessPackedMove deepMove;
+            minimax(searchGame, searchGame->difficulty, ALPHA, BETA, &deepMove, &search);
+            if (!search.isStopped) bestMove = deepMove;
+            ChessGame_Destroy(searchGame);
+        }
+        move = ChessGame_UnpackMove(bestMove);
+        getSearchStats(&search, &manager->stats);
+    }
     command.args[1] = move.from.x + 'A';
     command.args[0] = move.from.y + 1;
     command.args[3] = move.to.x + 'A';
@@ -403,6 +536,34 @@ GameCommand GameManager_GetAIMove(GameManager *manager) {
     return command;
 }
 
+bool GameManager_Search(ChessGame *game, int depth, const GameSearchHooks *hooks,
+                        GameSearchInfo *info) {
+    if (!game || !info) return false;
+    if (depth > GAME_SEARCH_MAX_DEPTH) depth = GAME_SEARCH_MAX_DEPTH;
+    Search search = { .hooks = NULL, .isStopped = false };
+    memset(&search.stats, 0, sizeof(search.stats));
+    memset(&search.evalStats, 0, sizeof(search.evalStats));
+    memset(info, 0, sizeof(GameSearchInfo));
+    ChessGame *searchGame = ChessGame_Copy(game); // searched in place
+    if (!searchGame) return false;
+    bool isFound = false;
+    for (int i = 1; i <= depth; i++) {
+        ChessPackedMove move = CHESS_MOVE_NONE;
+        int score = minimax(searchGame, i, ALPHA, BETA, &move, &search);
+        if (search.isStopped) break;
+        if (move == CHESS_MOVE_NONE) break; // no valid moves
+        isFound = true;
+        info->depth = i;
+        info->score = game->turn == CHESS_PLAYER_COLOR_WHITE ? score : -score;
+        info->bestMove = ChessGame_UnpackMove(move);
+        getSearchStats(&search, &info->stats);
+        if (hooks && hooks->onDepth) hooks->onDepth(info, hooks->context);
+        search.hooks = hooks; // only now, so depth 1 always completes
+    }
+    ChessGame_Destroy(searchGame);
+    return isFound;
+}
+
 char* slotToPath(unsigned int slot) {
     switch (slot) {
         case 1: return ".slot1.save";
@@ -453,6 +614,10 @@ void GameManager_ProcessCommand(GameManager *manager, GameCommand command) {
             processRunningCommand(manager, command);
         }
     }
+    if (manager->autosave && manager->error == GAME_ERROR_NONE &&
+        (command.type == GAME_COMMAND_MOVE || command.type == GAME_COMMAND_UNDO)) {
+        GameAutosave_Submit(manager->autosave, manager->game);
+    }
 }
 
 char* colorToString(const ChessGame *game) {
@@ -501,10 +666,31 @@ void GameManager_BoardToStream(const GameManager *manager, FILE *stream) {
     for (int i = CHESS_GRID - 1; i >= 0; i--) {
         fprintf(stream, "%d| ", i + 1);
         for (int j = 0; j < CHESS_GRID; j++) {
-            fprintf(stream, "%c ", manager->game->board[j][i]);
+            fprintf(stream, "%c ", CHESS_BOARD_AT(manager->game, j, i));
         }
         fprintf(stream, "|\n");
     }
     fprintf(stream, "  -----------------\n");
     fprintf(stream, "   A B C D E F G H\n");
 }
+
+/**
+ * Calculate a given hit count's rate, in percents.
+ * @return  0 if there were no probes
+ */
+double hitRate(unsigned long hits, unsigned long probes) {
+    return probes ? 100.0 * hits / probes : 0;
+}
+
+void GameManager_SearchStatsToStream(const GameManager *manager, FILE *stream) {
+    if (!manager || !stream) return;
+    const GameSearchStats *stats = &manager->stats;
+    fprintf(stream, "SEARCH STATS:\n");
+    fprintf(stream, "NODES: %lu\n", stats->nodes);
+    fprintf(stream, "EVAL CACHE: %lu/%lu (%.1f%%)\n",
+            stats->evalHits, stats->evalProbes, hitRate(stats->evalHits, stats->evalProbes));
+    fprintf(stream, "LAZY EXITS: %lu\n", stats->lazyExits);
+    fprintf(stream, "PAWN HASH: %lu/%lu (%.1f%%)\n",
+            stats->pawnHits, stats->pawnProbes, hitRate(stats->pawnHits, stats->pawnProbes));
+    fprintf(stream, "TABLEBASE HITS: %lu\n", stats->tablebaseHits);
+}
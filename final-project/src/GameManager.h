@@ -4,9 +4,11 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include "ChessGame.h"
+#include "GameAutosave.h"
 
 #define GAME_COMMAND_MAX_LINE_LENGTH    1024
 #define GAME_COMMAND_ARGS_CAPACITY      8
+#define GAME_SEARCH_MAX_DEPTH           64
 
 
 typedef enum GameCommandType {
@@ -15,6 +17,7 @@ typedef enum GameCommandType {
 	GAME_COMMAND_DIFFICULTY,
 	GAME_COMMAND_USER_COLOR,
     GAME_COMMAND_LOAD_GAME,
+    GAME_COMMAND_POSITION,
     GAME_COMMAND_DEFAULT_SETTINGS,
     GAME_COMMAND_PRINT_SETTINGS,
     GAME_COMMAND_START,
@@ -22,6 +25,7 @@ typedef enum GameCommandType {
     GAME_COMMAND_MOVE,
     GAME_COMMAND_GET_MOVES,
     GAME_COMMAND_SAVE,
+    GAME_COMMAND_EXPORT,
     GAME_COMMAND_UNDO,
     GAME_COMMAND_RESET,
     GAME_COMMAND_RESTART,
@@ -50,6 +54,7 @@ typedef enum GameError {
     GAME_ERROR_INVALID_DIFF_LEVEL,
     GAME_ERROR_INVALID_USER_COLOR,
     GAME_ERROR_INVALID_FILE,
+    GAME_ERROR_INVALID_FEN,
     GAME_ERROR_INVALID_POSITION,
     GAME_ERROR_EMPTY_POSITION,
     GAME_ERROR_NOT_CONTAIN_PLAYER_PIECE,
@@ -86,12 +91,44 @@ typedef enum GamePaneType {
     GAME_PANE_TYPE_LOAD,
 } GamePaneType;
 
+typedef struct GameSearchStats {
+    unsigned long nodes;
+    unsigned long evalProbes;
+    unsigned long evalHits;
+    unsigned long lazyExits;
+    unsigned long pawnProbes;
+    unsigned long pawnHits;
+    unsigned long tablebaseHits;
+} GameSearchStats;
+
+/**
+ * The result of a search by GameManager_Search(), as of its last completed depth.
+ */
+typedef struct GameSearchInfo {
+    int depth;
+    int score; // in centipawns, from the point of view of the player to move
+    ChessMove bestMove;
+    GameSearchStats stats; // of all of the search's depths so far
+} GameSearchInfo;
+
+/**
+ * Callbacks into a search by GameManager_Search(), called from its thread.
+ */
+typedef struct GameSearchHooks {
+    bool (*isStopped)(void *context); // polled every few nodes, or NULL
+    void (*onDepth)(const GameSearchInfo *info, void *context); // or NULL
+    void *context;
+    unsigned long maxNodes; // the search stops once it's searched about as many, 0 for no limit
+} GameSearchHooks;
+
 typedef struct GameManager {
     ChessGame *game;
     GamePhase phase;
     GameError error;
     ArrayStack *moves;
     GameStatus status;
+    GameSearchStats stats; // of the last AI move
+    GameAutosave *autosave; // NULL unless autosaving
     // GUI-related fields
     bool isSaved;
     unsigned int slot;
@@ -113,6 +150,16 @@ GameManager* GameManager_Create();
  */
 GameManager* GameManager_Destroy(GameManager *manager);
 
+/**
+ * Autosave a given GameManager's game to a given path after each move or
+ * undo, on a background thread - see GameAutosave_Submit().
+ * @param   manager     the instance to work on
+ * @param   path        the file path, replaced atomically by each save
+ * @return  true        if autosaving was started
+ *          false       if manager == NULL, path == NULL, or malloc failed
+ */
+bool GameManager_SetAutosave(GameManager *manager, const char *path);
+
 /**
  * Retrieve a given GameManager instance's current player type
  * @param   manager     the instance to work on
@@ -124,10 +171,38 @@ GamePlayerType GameManager_GetCurrentPlayerType(GameManager *manager);
 /**
  * Calculate an AI move using the minimax algorithm (with pruning),
  * according to the given GameManager's difficulty.
+ * Once hooks->isStopped() returns true, the best move of a depth 1 search
+ * is played instead.
  * @param   manager     the instance to work on
+ * @param   hooks       the search's callbacks, or NULL for a search that can't be stopped
  * @return  an AI DO_MOVE command
  */
-GameCommand GameManager_GetAIMove(GameManager *manager);
+GameCommand GameManager_GetAIMove(GameManager *manager, const GameSearchHooks *hooks);
+
+/**
+ * Search a given ChessGame by iterative deepening: using minimax to depth 1, 2,
+ * and so on up to a given depth, or until hooks->isStopped() returns true
+ * or hooks->maxNodes are searched.
+ * Depth 1 is always completed, so there's a move to play once stopped.
+ * The evaluation counters are reset, and must not be shared with another search.
+ * @param   game        the game to search, left unchanged
+ * @param   depth       the maximum depth, up to GAME_SEARCH_MAX_DEPTH
+ * @param   hooks       the search's callbacks, or NULL
+ * @param   info        output parameter for the deepest completed depth's result
+ * @return  true        if a move was found
+ *          false       if the player to move has no valid moves
+ */
+bool GameManager_Search(ChessGame *game, int depth, const GameSearchHooks *hooks,
+                        GameSearchInfo *info);
+
+/**
+ * Send a formatted string of a given GameManager's last AI move search
+ * statistics to a given stream.
+ * Does nothing if either manager == NULL or stream == NULL.
+ * @param   manager     the instance to fetch the string from
+ * @param   stream      the stream to send the string to
+ */
+void GameManager_SearchStatsToStream(const GameManager *manager, FILE *stream);
 
 /**
  * Update a GameManger instance according to a given command.
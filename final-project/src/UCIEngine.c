@@ -0,0 +1,386 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime()
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "UCIEngine.h"
+#include "ChessBook.h"
+#include "ChessEval.h"
+#include "ChessNnue.h"
+#include "ChessTablebase.h"
+
+#define UCI_LINE_SIZE           8192 // long enough for a few hundred moves
+#define UCI_MOVE_SIZE           6
+#define UCI_DEFAULT_MOVES_TO_GO 30
+#define UCI_MOVE_OVERHEAD       50 // milliseconds kept for the communication
+#define UCI_EMPTY_OPTION        "<empty>"
+
+#define MSG_ID                  "id name chessprog\nid author the chessprog authors"
+#define MSG_OPTION              "option name %s type string default " UCI_EMPTY_OPTION
+#define MSG_UCI_OK              "uciok"
+#define MSG_READY_OK            "readyok"
+#define MSG_INFO                "info depth %d score cp %d nodes %lu time %lld nps %lu pv %s"
+#define MSG_BEST_MOVE           "bestmove %s"
+#define MSG_NO_MOVE             "0000"
+#define MSG_INVALID_FEN         "info string invalid fen"
+#define MSG_INVALID_MOVE        "info string invalid move %s"
+#define MSG_OPTION_FAILED       "info string option %s cannot be set to %s"
+
+#define INPUT_DELIMITERS        " \t\r\n"
+
+
+typedef enum UCIOption {
+    UCI_OPTION_BOOK_FILE,
+    UCI_OPTION_EVAL_FILE,
+    UCI_OPTION_TABLEBASE_FILE,
+    UCI_OPTION_WEIGHTS_FILE,
+    UCI_OPTIONS,
+} UCIOption;
+
+static const char *optionNames[UCI_OPTIONS] = {
+    "BookFile",
+    "EvalFile",
+    "TablebaseFile",
+    "WeightsFile",
+};
+
+struct UCIEngine {
+    ChessGame *game;
+    // the running search - set before its thread starts, then owned by it
+    ChessGame *searchGame;
+    int depth;
+    bool isInfinite; // the best move is only sent once stopped
+    long long startTime;
+    long long deadline; // 0 for none
+    long long softDeadline; // no new depth is started past it, 0 for none
+    pthread_t thread;
+    bool isSearching; // the thread was started and not joined yet
+    // shared with the search thread
+    pthread_mutex_t lock; // guards isStopping and the output
+    pthread_cond_t stopped;
+    bool isStopping;
+};
+
+/**
+ * Retrieve the time on a monotonic clock.
+ * @return  the time in milliseconds
+ */
+long long getTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (long long)time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+/**
+ * Send a line to stdout, as a single write even while a search is running.
+ * @param   engine      the instance to use
+ * @param   format      the line's printf format, without the newline
+ */
+void writeLine(UCIEngine *engine, const char *format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    pthread_mutex_lock(&engine->lock);
+    vprintf(format, arguments);
+    putchar('\n');
+    fflush(stdout);
+    pthread_mutex_unlock(&engine->lock);
+    va_end(arguments);
+}
+
+/**
+ * Format a given move in UCI's long algebraic notation, e.g. "e2e4".
+ * @param   move        the move to format
+ * @param   string      output parameter, UCI_MOVE_SIZE long
+ */
+void moveToString(ChessMove move, char *string) {
+    string[0] = 'a' + move.from.x;
+    string[1] = '1' + move.from.y;
+    string[2] = 'a' + move.to.x;
+    string[3] = '1' + move.to.y;
+    string[4] = '\0';
+}
+
+/**
+ * Parse a move in UCI's long algebraic notation. Promotions aren't part of
+ * this game, so their moves are rejected.
+ * @param   string      the move to parse
+ * @param   move        output parameter for the parsed move
+ * @return  true        if string is a move on the board
+ *          false       otherwise
+ */
+bool stringToMove(const char *string, ChessMove *move) {
+    if (strlen(string) != 4) return false;
+    for (int i = 0; i < 4; i += 2) {
+        if (string[i] < 'a' || string[i] >= 'a' + CHESS_GRID) return false;
+        if (string[i + 1] < '1' || string[i + 1] >= '1' + CHESS_GRID) return false;
+    }
+    move->from = (ChessPos){ .x = string[0] - 'a', .y = string[1] - '1' };
+    move->to = (ChessPos){ .x = string[2] - 'a', .y = string[3] - '1' };
+    return true;
+}
+
+/**
+ * Check whether the running search should stop: if asked to, or out of time.
+ * Polled by GameManager_Search() from the search thread.
+ * @param   context     the UCIEngine
+ * @return  true        if the search should stop
+ *          false       otherwise
+ */
+bool isSearchStopped(void *context) {
+    UCIEngine *engine = context;
+    pthread_mutex_lock(&engine->lock);
+    bool isStopping = engine->isStopping;
+    pthread_mutex_unlock(&engine->lock);
+    return isStopping || (engine->deadline && getTime() >= engine->deadline);
+}
+
+/**
+ * Send the result of a completed search depth as an info line, and stop the
+ * search if a deeper one isn't likely to complete in time.
+ * Called by GameManager_Search() from the search thread.
+ * @param   info        the completed depth's result
+ * @param   context     the UCIEngine
+ */
+void writeSearchInfo(const GameSearchInfo *info, void *context) {
+    UCIEngine *engine = context;
+    long long now = getTime(), elapsed = now - engine->startTime;
+    char move[UCI_MOVE_SIZE];
+    moveToString(info->bestMove, move);
+    unsigned long nps = elapsed > 0 ? info->stats.nodes * 1000 / elapsed : info->stats.nodes;
+    writeLine(engine, MSG_INFO, info->depth, info->score, info->stats.nodes, elapsed, nps, move);
+    if (engine->softDeadline && now >= engine->softDeadline) {
+        pthread_mutex_lock(&engine->lock);
+        engine->isStopping = true;
+        pthread_mutex_unlock(&engine->lock);
+    }
+}
+
+/**
+ * Run a search on the engine's search game and send its best move.
+ * @param   argument    the UCIEngine
+ * @return  NULL
+ */
+void* runSearch(void *argument) {
+    UCIEngine *engine = argument;
+    GameSearchHooks hooks = {
+        .isStopped = isSearchStopped,
+        .onDepth = writeSearchInfo,
+        .context = engine,
+    };
+    GameSearchInfo info;
+    char move[UCI_MOVE_SIZE] = MSG_NO_MOVE;
+    if (!engine->isInfinite && ChessBook_Probe(engine->searchGame, &info.bestMove)) {
+        moveToString(info.bestMove, move);
+    } else if (GameManager_Search(engine->searchGame, engine->depth, &hooks, &info)) {
+        moveToString(info.bestMove, move);
+    }
+    if (engine->isInfinite) {
+        pthread_mutex_lock(&engine->lock);
+        while (!engine->isStopping) pthread_cond_wait(&engine->stopped, &engine->lock);
+        pthread_mutex_unlock(&engine->lock);
+    }
+    writeLine(engine, MSG_BEST_MOVE, move);
+    engine->searchGame = ChessGame_Destroy(engine->searchGame);
+    return NULL;
+}
+
+/**
+ * Stop the running search, if any, and wait for it to send its best move.
+ * @param   engine      the instance to use
+ */
+void stopSearch(UCIEngine *engine) {
+    if (!engine->isSearching) return;
+    pthread_mutex_lock(&engine->lock);
+    engine->isStopping = true;
+    pthread_cond_broadcast(&engine->stopped);
+    pthread_mutex_unlock(&engine->lock);
+    pthread_join(engine->thread, NULL);
+    engine->isSearching = false;
+}
+
+/**
+ * Handle a "go" command: start a search of the current position, limited by
+ * the command's depth, movetime, or the player to move's clock.
+ * @param   engine      the instance to use
+ */
+void startSearch(UCIEngine *engine) {
+    stopSearch(engine);
+    long long times[2] = { 0, 0 }, increments[2] = { 0, 0 }, movetime = 0;
+    long long movesToGo = UCI_DEFAULT_MOVES_TO_GO;
+    int depth = 0;
+    bool isInfinite = false;
+    char *token;
+    while ((token = strtok(NULL, INPUT_DELIMITERS))) {
+        char *value = NULL;
+        if (strcmp(token, "infinite") == 0) {
+            isInfinite = true;
+        } else if (strcmp(token, "ponder") == 0) {
+            continue; // pondering isn't offered, so searched as a regular move
+        } else if ((value = strtok(NULL, INPUT_DELIMITERS))) {
+            long long number = atoll(value);
+            if (strcmp(token, "depth") == 0) depth = (int)number;
+            if (strcmp(token, "movetime") == 0) movetime = number;
+            if (strcmp(token, "wtime") == 0) times[CHESS_PLAYER_COLOR_WHITE] = number;
+            if (strcmp(token, "btime") == 0) times[CHESS_PLAYER_COLOR_BLACK] = number;
+            if (strcmp(token, "winc") == 0) increments[CHESS_PLAYER_COLOR_WHITE] = number;
+            if (strcmp(token, "binc") == 0) increments[CHESS_PLAYER_COLOR_BLACK] = number;
+            if (strcmp(token, "movestogo") == 0 && number > 0) movesToGo = number;
+        }
+    }
+    ChessColor turn = engine->game->turn;
+    engine->startTime = getTime();
+    engine->deadline = engine->softDeadline = 0;
+    if (movetime > 0) {
+        long long budget = movetime > UCI_MOVE_OVERHEAD ? movetime - UCI_MOVE_OVERHEAD : 1;
+        engine->deadline = engine->startTime + budget;
+    } else if (times[turn] > 0) {
+        long long budget = times[turn] / movesToGo + increments[turn] * 3 / 4;
+        if (budget > times[turn] - UCI_MOVE_OVERHEAD) budget = times[turn] - UCI_MOVE_OVERHEAD;
+        if (budget < 1) budget = 1;
+        engine->deadline = engine->startTime + budget;
+        engine->softDeadline = engine->startTime + budget / 2;
+    }
+    // a bare "go" searches until stopped
+    engine->isInfinite = isInfinite || (!depth && !engine->deadline);
+    engine->depth = depth > 0 && !isInfinite ? depth : GAME_SEARCH_MAX_DEPTH;
+    engine->isStopping = false;
+    engine->searchGame = ChessGame_Copy(engine->game);
+    if (!engine->searchGame) {
+        writeLine(engine, MSG_BEST_MOVE, MSG_NO_MOVE);
+        return;
+    }
+    if (pthread_create(&engine->thread, NULL, runSearch, engine) == 0) {
+        engine->isSearching = true;
+    } else { // search right here, without being able to stop
+        engine->isInfinite = false;
+        runSearch(engine);
+    }
+}
+
+/**
+ * Handle a "position [startpos | fen <fen>] [moves <move>...]" command.
+ * On an invalid FEN the position doesn't change, and on an invalid move
+ * the moves before it are kept.
+ * @param   engine      the instance to use
+ */
+void setPosition(UCIEngine *engine) {
+    stopSearch(engine);
+    char *token = strtok(NULL, INPUT_DELIMITERS);
+    if (!token) return;
+    if (strcmp(token, "startpos") == 0) {
+        ChessGame_ResetGame(engine->game);
+        token = strtok(NULL, INPUT_DELIMITERS);
+    } else if (strcmp(token, "fen") == 0) {
+        char fen[UCI_LINE_SIZE] = "";
+        while ((token = strtok(NULL, INPUT_DELIMITERS)) && strcmp(token, "moves") != 0) {
+            if (*fen) strcat(fen, " ");
+            strcat(fen, token);
+        }
+        if (ChessGame_FromFEN(engine->game, fen) != CHESS_SUCCESS) {
+            writeLine(engine, MSG_INVALID_FEN);
+            return;
+        }
+    } else {
+        return;
+    }
+    if (!token || strcmp(token, "moves") != 0) return;
+    while ((token = strtok(NULL, INPUT_DELIMITERS))) {
+        ChessMove move;
+        if (!stringToMove(token, &move) || ChessGame_DoMove(engine->game, move) != CHESS_SUCCESS) {
+            writeLine(engine, MSG_INVALID_MOVE, token);
+            return;
+        }
+    }
+}
+
+/**
+ * Handle a "setoption name <name> value <value>" command, where a value of
+ * UCI_EMPTY_OPTION unloads the option's file.
+ * @param   engine      the instance to use
+ */
+void setOption(UCIEngine *engine) {
+    stopSearch(engine);
+    char *token = strtok(NULL, INPUT_DELIMITERS);
+    if (!token || strcmp(token, "name") != 0) return;
+    char *name = strtok(NULL, INPUT_DELIMITERS);
+    if (!name || !(token = strtok(NULL, INPUT_DELIMITERS)) || strcmp(token, "value") != 0) return;
+    char *value = strtok(NULL, "\r\n"); // paths may have spaces
+    if (!value) return;
+    bool isEmpty = strcmp(value, UCI_EMPTY_OPTION) == 0, isSet = true;
+    if (strcmp(name, optionNames[UCI_OPTION_BOOK_FILE]) == 0) {
+        if (isEmpty) ChessBook_Unload(); else isSet = ChessBook_Load(value);
+    } else if (strcmp(name, optionNames[UCI_OPTION_TABLEBASE_FILE]) == 0) {
+        if (isEmpty) ChessTablebase_Unload(); else isSet = ChessTablebase_Load(value);
+    } else if (strcmp(name, optionNames[UCI_OPTION_EVAL_FILE]) == 0) {
+        if (isEmpty) ChessNnue_Unload(); else isSet = ChessNnue_Load(value);
+        ChessEval_ClearCache();
+    } else if (strcmp(name, optionNames[UCI_OPTION_WEIGHTS_FILE]) == 0) {
+        isSet = !isEmpty && ChessEval_LoadWeights(value);
+    } else {
+        return; // not one of ours
+    }
+    ChessGame_RefreshState(engine->game); // for the network's accumulator & the weights' scores
+    if (!isSet) writeLine(engine, MSG_OPTION_FAILED, name, value);
+}
+
+UCIEngine* UCIEngine_Create() {
+    UCIEngine *engine = malloc(sizeof(UCIEngine));
+    if (!engine) return NULL;
+    engine->game = ChessGame_Create();
+    if (!engine->game) {
+        free(engine);
+        return NULL;
+    }
+    ChessGame_ResetGame(engine->game);
+    engine->searchGame = NULL;
+    engine->isSearching = engine->isStopping = false;
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->stopped, NULL);
+    return engine;
+}
+
+UCIEngine* UCIEngine_Destroy(UCIEngine *engine) {
+    if (!engine) return NULL;
+    stopSearch(engine);
+    ChessGame_Destroy(engine->game);
+    pthread_mutex_destroy(&engine->lock);
+    pthread_cond_destroy(&engine->stopped);
+    free(engine);
+    return NULL;
+}
+
+GameCommand UCIEngine_ProcessInput(UCIEngine *engine) {
+    GameCommand command = { .type = GAME_COMMAND_QUIT };
+    if (!engine) return command;
+    char line[UCI_LINE_SIZE];
+    while (fgets(line, sizeof(line), stdin)) {
+        char *name = strtok(line, INPUT_DELIMITERS);
+        if (!name) continue;
+        if (strcmp(name, "uci") == 0) {
+            writeLine(engine, MSG_ID);
+            for (int i = 0; i < UCI_OPTIONS; i++) writeLine(engine, MSG_OPTION, optionNames[i]);
+            writeLine(engine, MSG_UCI_OK);
+        } else if (strcmp(name, "isready") == 0) {
+            writeLine(engine, MSG_READY_OK);
+        } else if (strcmp(name, "ucinewgame") == 0) {
+            stopSearch(engine);
+            ChessEval_ClearCache();
+            ChessGame_ResetGame(engine->game);
+        } else if (strcmp(name, "position") == 0) {
+            setPosition(engine);
+        } else if (strcmp(name, "go") == 0) {
+            startSearch(engine);
+        } else if (strcmp(name, "stop") == 0) {
+            stopSearch(engine);
+        } else if (strcmp(name, "setoption") == 0) {
+            setOption(engine);
+        } else if (strcmp(name, "quit") == 0) {
+            break;
+        } // other commands, such as "debug" & "ponderhit", are ignored
+    }
+    stopSearch(engine);
+    return command;
+}
@@ -0,0 +1,33 @@
+#ifndef UCI_ENGINE_H_
+#define UCI_ENGINE_H_
+
+#include "GameManager.h"
+
+
+typedef struct UCIEngine UCIEngine;
+
+/**
+ * Create new UCIEngine instance, with its own game at the starting position.
+ * @return  NULL if malloc failed
+ *          UCIEngine* instance otherwise
+ */
+UCIEngine* UCIEngine_Create();
+
+/**
+ * Free all resources for a given UCIEngine instance, stopping its search.
+ * @param   engine      the instance to destroy
+ * @return  NULL
+ */
+UCIEngine* UCIEngine_Destroy(UCIEngine *engine);
+
+/**
+ * Run a Universal Chess Interface session over stdin & stdout, until a "quit"
+ * command or the end of the input. Searches run on a thread of their own,
+ * so commands - "stop" in particular - are handled while searching.
+ * @param   engine      the instance to use
+ * @return  command     a GAME_COMMAND_QUIT
+ */
+GameCommand UCIEngine_ProcessInput(UCIEngine *engine);
+
+
+#endif
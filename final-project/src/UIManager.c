@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include "UIManager.h"
@@ -5,23 +6,53 @@
 
 struct UIManager {
     UIType type;
+    bool isJson; // the CLI answers in JSON lines
     CLIEngine *cliEngine;
     GUIEngine *guiEngine;
+    UCIEngine *uciEngine;
+    BatchEngine *batchEngine;
 };
 
+/**
+ * Check whether a given flag is one of the command-line arguments.
+ * @param   argc        number of command-line arguments
+ * @param   argv        the command-line arguments
+ * @param   flag        the flag to look for
+ * @return  true        if flag was given
+ *          false       otherwise
+ */
+bool hasFlag(int argc, const char *argv[], const char *flag) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], flag) == 0) return true;
+    }
+    return false;
+}
+
 UIManager* UIManager_Create(int argc, const char *argv[]) {
     UIManager *uiManager = malloc(sizeof(UIManager));
     if (!uiManager) return NULL;    
-    if (argc > 1 && strcmp(argv[1], "-g") == 0) {
+    uiManager->cliEngine = NULL;
+    uiManager->guiEngine = NULL;
+    uiManager->uciEngine = NULL;
+    uiManager->batchEngine = NULL;
+    uiManager->isJson = false;
+    if (hasFlag(argc, argv, "-g")) {
         uiManager->type = UI_TYPE_GUI;
         uiManager->guiEngine = GUIEngine_Create();
         if (!uiManager->guiEngine) return UIManager_Destroy(uiManager);
-        uiManager->cliEngine = NULL;
+    } else if (hasFlag(argc, argv, "-u")) {
+        uiManager->type = UI_TYPE_UCI;
+        uiManager->uciEngine = UCIEngine_Create();
+        if (!uiManager->uciEngine) return UIManager_Destroy(uiManager);
+    } else if (hasFlag(argc, argv, "--batch")) {
+        uiManager->type = UI_TYPE_BATCH;
+        uiManager->batchEngine = BatchEngine_Create(argc, argv);
+        if (!uiManager->batchEngine) return UIManager_Destroy(uiManager);
     } else {
         uiManager->type = UI_TYPE_CLI;
-        uiManager->cliEngine = CLIEngine_Create();
+        uiManager->isJson = hasFlag(argc, argv, "--json");
+        uiManager->cliEngine = CLIEngine_Create(uiManager->isJson, !hasFlag(argc, argv, "--no-timing"));
         if (!uiManager->cliEngine) return UIManager_Destroy(uiManager);
-        uiManager->guiEngine = NULL;
     }
     return uiManager;
 }
@@ -30,6 +61,8 @@ UIManager* UIManager_Destroy(UIManager *uiManager) {
     if (!uiManager) return NULL;
     CLIEngine_Destroy(uiManager->cliEngine);
     GUIEngine_Destroy(uiManager->guiEngine);
+    UCIEngine_Destroy(uiManager->uciEngine);
+    BatchEngine_Destroy(uiManager->batchEngine);
     free(uiManager);
     return NULL;
 }
@@ -45,16 +78,31 @@ GameCommand UIManager_ProcessInput(UIManager *uiManager) {
     switch (uiManager->type) {
         case UI_TYPE_GUI:    
             return GUIEngine_ProcessInput(uiManager->guiEngine);
+        case UI_TYPE_UCI:
+            return UCIEngine_ProcessInput(uiManager->uciEngine);
+        case UI_TYPE_BATCH:
+            return BatchEngine_ProcessInput(uiManager->batchEngine);
         case UI_TYPE_CLI:
         default:
             return CLIEngine_ProcessInput(uiManager->cliEngine);
     }
 }
 
+const GameSearchHooks* UIManager_GetSearchHooks(UIManager *uiManager) {
+    if (!uiManager || uiManager->type != UI_TYPE_CLI) return NULL;
+    return CLIEngine_GetSearchHooks(uiManager->cliEngine);
+}
+
 void UIManager_Render(UIManager *uiManager,
                       const GameManager *gameManager,
                       const GameCommand command) {
-    if (!uiManager) return;
+    if (!uiManager || uiManager->type == UI_TYPE_UCI || uiManager->type == UI_TYPE_BATCH) {
+        return; // UCI & batch have their own output
+    }
+    if (uiManager->isJson) {
+        CLIEngine_RenderJson(uiManager->cliEngine, gameManager, command);
+        return;
+    }
     CLIEngine_RenderError(gameManager, uiManager->type == UI_TYPE_CLI);
     if (uiManager->type == UI_TYPE_GUI) {
         GUIEngine_Render(uiManager->guiEngine, gameManager, command);
@@ -3,6 +3,8 @@
 
 #include "CLIEngine.h"
 #include "GUIEngine.h"
+#include "UCIEngine.h"
+#include "BatchEngine.h"
 #include "GameManager.h"
 
 
@@ -10,13 +12,16 @@ typedef enum UIType {
     UI_TYPE_NONE,
     UI_TYPE_CLI,
     UI_TYPE_GUI,
+    UI_TYPE_UCI,
+    UI_TYPE_BATCH,
 } UIType;
 
 typedef struct UIManager UIManager;
 
 /**
- * Create new UIEngine instance, using CLIEngine or GUIEngine based on
- * the command-line arguments.
+ * Create new UIEngine instance, using CLIEngine (answering in JSON lines
+ * with "--json", timed unless "--no-timing" is given), GUIEngine ("-g"), UCIEngine ("-u") or BatchEngine ("--batch")
+ * based on the command-line arguments.
  * @param   argc        number of command-line arguments
  * @param   argv        the command-line arguments
  * @return  NULL if malloc failed
@@ -46,6 +51,15 @@ UIType UIManager_GetUIType(const UIManager *uiManager);
  */
 GameCommand UIManager_ProcessInput(UIManager *uiManager);
 
+/**
+ * Retrieve the search hooks that let a given UIManager's input stop
+ * the AI's search.
+ * @param   uiManager   the UIManager instance to use
+ * @return  NULL if the AI's search can't be stopped
+ *          the hooks otherwise
+ */
+const GameSearchHooks* UIManager_GetSearchHooks(UIManager *uiManager);
+
 /**
  * Output current game state.
  * @param   uiManager   the UIManager instance to use
@@ -1,6 +1,20 @@
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "UIManager.h"
 #include "GameManager.h"
+#include "ChessBook.h"
+#include "ChessEval.h"
+#include "ChessNnue.h"
+#include "ChessTablebase.h"
+
+#define MSG_NNUE_LOAD_FAILED    "ERROR: NNUE file %s cannot be loaded, using the classical evaluation\n"
+#define MSG_WEIGHTS_LOAD_FAILED "ERROR: weights file %s cannot be loaded, using the default weights\n"
+#define MSG_TABLEBASE_LOAD_FAILED "ERROR: tablebase file %s cannot be loaded, searching endgames without it\n"
+#define MSG_BOOK_LOAD_FAILED    "ERROR: opening book %s cannot be loaded, searching every move\n"
+#define MSG_AUTOSAVE_FAILED     "ERROR: autosave to %s cannot be started\n"
 
 
 bool toQuit(GameManager *gameManager, UIManager *uiManager, GameCommand command) {
@@ -19,14 +33,97 @@ GameCommand getNextCommand(GameManager *gameManager, UIManager *uiManager) {
             case GAME_PLAYER_TYPE_HUMAN:
                 return UIManager_ProcessInput(uiManager);
             case GAME_PLAYER_TYPE_AI:
-                return GameManager_GetAIMove(gameManager);
+                return GameManager_GetAIMove(gameManager, UIManager_GetSearchHooks(uiManager));
         }
     }
     return (GameCommand){ .type = GAME_COMMAND_INVALID };
 }
 
+/**
+ * Load the NNUE network of a "-n <path>" command-line argument, if given.
+ * Must be done before any game is created, as games only maintain
+ * their accumulators while a network is loaded.
+ * @param   argc        number of command-line arguments
+ * @param   argv        the command-line arguments
+ */
+void loadNetwork(int argc, const char *argv[]) {
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-n") != 0) continue;
+        if (!ChessNnue_Load(argv[i + 1])) fprintf(stderr, MSG_NNUE_LOAD_FAILED, argv[i + 1]);
+        ChessEval_ClearCache();
+        return;
+    }
+}
+
+/**
+ * Load the classical evaluation weights of a "-w <path>" command-line
+ * argument, as written by the tune tool, if given.
+ * Must be done before any game is created, as games keep their material
+ * scores incrementally.
+ * @param   argc        number of command-line arguments
+ * @param   argv        the command-line arguments
+ */
+void loadWeights(int argc, const char *argv[]) {
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-w") != 0) continue;
+        if (!ChessEval_LoadWeights(argv[i + 1])) fprintf(stderr, MSG_WEIGHTS_LOAD_FAILED, argv[i + 1]);
+        return;
+    }
+}
+
+/**
+ * Load the endgame tablebase of a "-t <path>" command-line argument,
+ * as written by the tbgen tool, if given.
+ * @param   argc        number of command-line arguments
+ * @param   argv        the command-line arguments
+ */
+void loadTablebase(int argc, const char *argv[]) {
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-t") != 0) continue;
+        if (!ChessTablebase_Load(argv[i + 1])) fprintf(stderr, MSG_TABLEBASE_LOAD_FAILED, argv[i + 1]);
+        return;
+    }
+}
+
+/**
+ * Load the opening book of a "-b <path>" command-line argument, if given,
+ * and seed its random choice of moves.
+ * @param   argc        number of command-line arguments
+ * @param   argv        the command-line arguments
+ */
+void loadBook(int argc, const char *argv[]) {
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-b") != 0) continue;
+        if (!ChessBook_Load(argv[i + 1])) fprintf(stderr, MSG_BOOK_LOAD_FAILED, argv[i + 1]);
+        srand(time(NULL));
+        return;
+    }
+}
+
+/**
+ * Autosave the game to the path of a "-a <path>" command-line argument,
+ * if given, after each move.
+ * @param   argc        number of command-line arguments
+ * @param   argv        the command-line arguments
+ * @param   gameManager the game to autosave
+ */
+void startAutosave(int argc, const char *argv[], GameManager *gameManager) {
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-a") != 0) continue;
+        if (!GameManager_SetAutosave(gameManager, argv[i + 1])) {
+            fprintf(stderr, MSG_AUTOSAVE_FAILED, argv[i + 1]);
+        }
+        return;
+    }
+}
+
 int main(int argc, const char *argv[]) {
+    loadWeights(argc, argv);
+    loadNetwork(argc, argv);
+    loadTablebase(argc, argv);
+    loadBook(argc, argv);
     GameManager *gameManager = GameManager_Create();
+    startAutosave(argc, argv, gameManager);
     UIManager *uiManager = UIManager_Create(argc, argv);
     GameCommand command = { .type = GAME_COMMAND_INVALID };
     while (true) {
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ChessGame.h"
+#include "ChessEval.h"
+#include "ChessNnue.h"
+
+#define BENCH_POSITIONS         256
+#define BENCH_MAX_PLIES         80
+#define BENCH_ITERATIONS        2000
+#define BENCH_SEED              20180801ULL
+
+#define MSG_USAGE               "usage: bench [iterations] [nnue file]\n"
+#define MSG_NNUE_LOAD_FAILED    "ERROR: NNUE file %s cannot be loaded\n"
+#define MSG_NNUE_RANDOM         "no NNUE file given, using random weights\n"
+#define MSG_RESULT              "%-16s %12.0f evals/s\n"
+
+
+static volatile int sink; // keeps the evaluations from being optimized away
+
+/**
+ * Play a random legal move on a given game.
+ * @param   game        the game to play on
+ * @return  false       if the player to move has no moves
+ *          true        otherwise
+ */
+bool playRandomMove(ChessGame *game) {
+    ChessMove moves[CHESS_GRID * CHESS_GRID];
+    int movesCount = 0;
+    ArrayStack *positions = NULL;
+    for (int i = 0; i < CHESS_GRID; i++) {
+        for (int j = 0; j < CHESS_GRID; j++) {
+            ChessColor color;
+            ChessGame_GetPieceColor(CHESS_BOARD_AT(game, i, j), &color);
+            if (color != game->turn) continue;
+            ChessPos from = { .x = i, .y = j };
+            ChessGame_GetMoves(game, from, &positions);
+            while (!ArrayStack_IsEmpty(positions) && movesCount < CHESS_GRID * CHESS_GRID) {
+                moves[movesCount].from = from;
+                moves[movesCount++].to = *(ChessPos *)ArrayStack_Pop(positions);
+            }
+            ArrayStack_Destroy(positions);
+        }
+    }
+    if (!movesCount) return false;
+    return ChessGame_DoMove(game, moves[rand() % movesCount]) == CHESS_SUCCESS;
+}
+
+/**
+ * Collect positions along random games.
+ * @param   positions   output parameter, BENCH_POSITIONS games
+ */
+void collectPositions(ChessGame **positions) {
+    ChessGame *game = ChessGame_Create();
+    ChessGame_InitBoard(game);
+    for (int i = 0, plies = 0; i < BENCH_POSITIONS; i++, plies++) {
+        if (plies == BENCH_MAX_PLIES || !playRandomMove(game)) {
+            ChessGame_ResetGame(game);
+            plies = 0;
+        }
+        positions[i] = ChessGame_Copy(game);
+    }
+    ChessGame_Destroy(game);
+}
+
+double benchClassical(ChessGame **positions, int iterations) {
+    clock_t start = clock();
+    for (int i = 0; i < iterations; i++) {
+        for (int j = 0; j < BENCH_POSITIONS; j++) {
+            sink = ChessEval_Evaluate(positions[j]);
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    return seconds > 0 ? (double)iterations * BENCH_POSITIONS / seconds : 0;
+}
+
+double benchNnue(ChessGame **positions, int iterations) {
+    clock_t start = clock();
+    for (int i = 0; i < iterations; i++) {
+        for (int j = 0; j < BENCH_POSITIONS; j++) {
+            sink = ChessNnue_Evaluate(&positions[j]->accumulator,
+                                      positions[j]->turn == CHESS_PLAYER_COLOR_WHITE);
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    return seconds > 0 ? (double)iterations * BENCH_POSITIONS / seconds : 0;
+}
+
+int main(int argc, const char *argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : BENCH_ITERATIONS;
+    if (iterations <= 0) {
+        printf(MSG_USAGE);
+        return 1;
+    }
+    if (argc > 2) {
+        if (!ChessNnue_Load(argv[2])) {
+            printf(MSG_NNUE_LOAD_FAILED, argv[2]);
+            return 1;
+        }
+    } else {
+        printf(MSG_NNUE_RANDOM);
+        ChessNnue_LoadRandom(BENCH_SEED);
+    }
+    srand(BENCH_SEED);
+    ChessGame *positions[BENCH_POSITIONS];
+    collectPositions(positions);
+    printf(MSG_RESULT, "classical", benchClassical(positions, iterations));
+    ChessNnueKernel kernels[] = {
+        CHESS_NNUE_KERNEL_SCALAR, CHESS_NNUE_KERNEL_SSE41, CHESS_NNUE_KERNEL_AVX2,
+    };
+    for (unsigned int i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        if (!ChessNnue_SetKernel(kernels[i])) continue;
+        char name[32];
+        snprintf(name, sizeof(name), "nnue (%s)", ChessNnue_KernelToString(kernels[i]));
+        printf(MSG_RESULT, name, benchNnue(positions, iterations));
+    }
+    for (int i = 0; i < BENCH_POSITIONS; i++) ChessGame_Destroy(positions[i]);
+    return 0;
+}
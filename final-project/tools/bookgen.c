@@ -0,0 +1,329 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ChessGame.h"
+#include "ChessBook.h"
+#include "ChessPgn.h"
+
+#define BOOKGEN_DEFAULT_PLIES   24
+#define BOOKGEN_DEFAULT_MEMORY  64 // megabytes of position / move counts held in memory
+#define BOOKGEN_MAX_RUNS        64 // merged into one once reached, so few files are open
+#define BOOKGEN_MAX_MOVES       256 // per position
+#define BOOKGEN_WIN_WEIGHT      2
+#define BOOKGEN_DRAW_WEIGHT     1
+
+#define MSG_USAGE               "usage: bookgen <pgn file> <book output> [plies] [memory MB]\n"
+#define MSG_PGN_FAILED          "ERROR: PGN file %s cannot be read\n"
+#define MSG_BOOK_FAILED         "ERROR: book file %s cannot be written\n"
+#define MSG_RUN_FAILED          "ERROR: temporary file cannot be written\n"
+#define MSG_ALLOC_FAILED        "ERROR: out of memory\n"
+#define MSG_DONE                "%lu games (%lu cut short), %lu positions, %lu moves\n"
+
+
+/**
+ * A position / move pair and its weight: the points its player scored with it.
+ */
+typedef struct Record {
+    uint64_t key;
+    uint32_t weight; // 0 for an empty hash map slot
+    uint16_t move;
+} Record;
+
+/**
+ * A move of the game being read, kept until the game's result is known.
+ */
+typedef struct GameMove {
+    uint64_t key;
+    uint16_t move;
+    ChessColor player;
+} GameMove;
+
+/**
+ * The first moves of the game being read, up to the book's plies.
+ */
+typedef struct GameMoves {
+    GameMove *moves;
+    int count;
+    int plies;
+} GameMoves;
+
+/**
+ * The records of the games read so far: the latest in an open addressing hash
+ * map, and the rest in runs sorted by key & move, each in a temporary file.
+ */
+typedef struct Builder {
+    Record *records;
+    size_t capacity; // a power of 2
+    size_t size;
+    FILE *runs[BOOKGEN_MAX_RUNS];
+    int runsCount;
+    Record moves[BOOKGEN_MAX_MOVES]; // of the position being written to the book
+    int movesCount;
+    unsigned long positions;
+    unsigned long entries;
+} Builder;
+
+/**
+ * Keep a move of the game being read, a ChessPgnHooks.onMove callback.
+ * @param   game        the game, before the move
+ * @param   move        the move
+ * @param   context     the GameMoves to keep the move in
+ * @return  true        if the move was kept
+ *          false       if the book's plies were reached, to skip the rest of the game
+ */
+bool onGameMove(const ChessGame *game, ChessMove move, void *context) {
+    GameMoves *gameMoves = context;
+    if (gameMoves->count == gameMoves->plies) return false;
+    gameMoves->moves[gameMoves->count++] = (GameMove){
+        .key = game->hash,
+        .move = ChessBook_EncodeMove(move),
+        .player = game->turn,
+    };
+    return true;
+}
+
+int compareRecords(const void *a, const void *b) {
+    const Record *first = a, *second = b;
+    if (first->key != second->key) return first->key < second->key ? -1 : 1;
+    return (int)first->move - (int)second->move;
+}
+
+int compareWeights(const void *a, const void *b) {
+    const Record *first = a, *second = b;
+    if (first->weight != second->weight) return first->weight > second->weight ? -1 : 1;
+    return (int)first->move - (int)second->move;
+}
+
+/**
+ * Add a given weight to another, saturating instead of overflowing.
+ * @param   weight      the weight to add to
+ * @param   addition    the weight to add
+ */
+void addWeight(uint32_t *weight, uint32_t addition) {
+    *weight = *weight > UINT32_MAX - addition ? UINT32_MAX : *weight + addition;
+}
+
+/**
+ * Write the moves collected for a position to the book, heaviest first,
+ * scaling their weights to fit a book entry.
+ * @param   builder     the builder
+ * @param   file        the book file
+ * @return  true        if the moves were written
+ *          false       otherwise
+ */
+bool writePosition(Builder *builder, FILE *file) {
+    if (!builder->movesCount) return true;
+    qsort(builder->moves, builder->movesCount, sizeof(Record), compareWeights);
+    uint32_t maxWeight = builder->moves[0].weight;
+    for (int i = 0; i < builder->movesCount; i++) {
+        Record *record = &builder->moves[i];
+        uint64_t weight = record->weight;
+        if (maxWeight > UINT16_MAX) {
+            weight = weight * UINT16_MAX / maxWeight;
+            if (!weight) weight = 1;
+        }
+        ChessBookEntry entry = {
+            .key = record->key,
+            .move = record->move,
+            .weight = weight,
+            .learn = 0,
+        };
+        if (!ChessBook_WriteEntry(file, &entry)) return false;
+    }
+    builder->positions++;
+    builder->entries += builder->movesCount;
+    builder->movesCount = 0;
+    return true;
+}
+
+/**
+ * Merge all of the runs into a single sorted sequence, summing the weights
+ * of the same position / move, and write it to a given file - either as
+ * a single run, or as the final book.
+ * @param   builder     the builder, its runs are closed
+ * @param   file        the file to write to
+ * @param   isBook      true for the book, false for a run
+ * @return  true        if the merged sequence was written
+ *          false       otherwise
+ */
+bool mergeRuns(Builder *builder, FILE *file, bool isBook) {
+    Record heads[BOOKGEN_MAX_RUNS];
+    bool hasHead[BOOKGEN_MAX_RUNS];
+    for (int i = 0; i < builder->runsCount; i++) {
+        hasHead[i] = fread(&heads[i], sizeof(Record), 1, builder->runs[i]) == 1;
+    }
+    bool isWritten = true;
+    while (isWritten) {
+        int first = -1;
+        for (int i = 0; i < builder->runsCount; i++) {
+            if (hasHead[i] && (first < 0 || compareRecords(&heads[i], &heads[first]) < 0)) {
+                first = i;
+            }
+        }
+        if (first < 0) break;
+        Record record = heads[first];
+        record.weight = 0;
+        for (int i = 0; i < builder->runsCount; i++) {
+            while (hasHead[i] && compareRecords(&heads[i], &record) == 0) {
+                addWeight(&record.weight, heads[i].weight);
+                hasHead[i] = fread(&heads[i], sizeof(Record), 1, builder->runs[i]) == 1;
+            }
+        }
+        if (!isBook) {
+            isWritten = fwrite(&record, sizeof(Record), 1, file) == 1;
+            continue;
+        }
+        if (builder->movesCount && builder->moves[0].key != record.key) {
+            isWritten = writePosition(builder, file);
+        }
+        if (builder->movesCount < BOOKGEN_MAX_MOVES) builder->moves[builder->movesCount++] = record;
+    }
+    if (isBook && isWritten) isWritten = writePosition(builder, file);
+    for (int i = 0; i < builder->runsCount; i++) fclose(builder->runs[i]);
+    builder->runsCount = 0;
+    return isWritten;
+}
+
+/**
+ * Write the records of the hash map to a new run, sorted, and empty it.
+ * Once there are BOOKGEN_MAX_RUNS runs, they're merged into one first.
+ * @param   builder     the builder
+ * @return  true        if the run was written
+ *          false       otherwise
+ */
+bool flushRecords(Builder *builder) {
+    if (!builder->size) return true;
+    if (builder->runsCount == BOOKGEN_MAX_RUNS) {
+        FILE *merged = tmpfile();
+        if (!merged || !mergeRuns(builder, merged, false)) {
+            if (merged) fclose(merged);
+            return false;
+        }
+        rewind(merged);
+        builder->runs[builder->runsCount++] = merged;
+    }
+    size_t size = 0;
+    for (size_t i = 0; i < builder->capacity; i++) {
+        if (builder->records[i].weight) builder->records[size++] = builder->records[i];
+    }
+    qsort(builder->records, size, sizeof(Record), compareRecords);
+    FILE *run = tmpfile();
+    if (!run || fwrite(builder->records, sizeof(Record), size, run) != size) {
+        if (run) fclose(run);
+        return false;
+    }
+    rewind(run);
+    builder->runs[builder->runsCount++] = run;
+    memset(builder->records, 0, builder->capacity * sizeof(Record));
+    builder->size = 0;
+    return true;
+}
+
+/**
+ * Add a weight to a position / move pair's record.
+ * @param   builder     the builder
+ * @param   key         the position's key
+ * @param   move        the book entry move
+ * @param   weight      the weight to add
+ * @return  true        if the weight was added
+ *          false       if the hash map had to be flushed, and couldn't be
+ */
+bool addRecord(Builder *builder, uint64_t key, uint16_t move, uint32_t weight) {
+    if (!weight) return true; // never played from the book anyway
+    size_t mask = builder->capacity - 1;
+    size_t i = (key ^ (key >> 29) ^ ((uint64_t)move * 0x9e3779b97f4a7c15ULL)) & mask;
+    for (; builder->records[i].weight; i = (i + 1) & mask) {
+        Record *record = &builder->records[i];
+        if (record->key == key && record->move == move) {
+            addWeight(&record->weight, weight);
+            return true;
+        }
+    }
+    if (builder->size + 1 > builder->capacity / 4 * 3) {
+        if (!flushRecords(builder)) return false;
+        return addRecord(builder, key, move, weight);
+    }
+    builder->records[i] = (Record){ .key = key, .move = move, .weight = weight };
+    builder->size++;
+    return true;
+}
+
+/**
+ * Add the moves of a game to the records, each weighted by the points
+ * its player scored in the game.
+ * @param   builder     the builder
+ * @param   moves       the game's moves
+ * @param   count       the number of moves
+ * @param   result      the game's result token
+ * @return  true        if the moves were added
+ *          false       otherwise
+ */
+bool addGame(Builder *builder, const GameMove *moves, int count, const char *result) {
+    for (int i = 0; i < count; i++) {
+        uint32_t weight = BOOKGEN_DRAW_WEIGHT; // also for unfinished games
+        if (strcmp(result, "1-0") == 0) {
+            weight = moves[i].player == CHESS_PLAYER_COLOR_WHITE ? BOOKGEN_WIN_WEIGHT : 0;
+        } else if (strcmp(result, "0-1") == 0) {
+            weight = moves[i].player == CHESS_PLAYER_COLOR_BLACK ? BOOKGEN_WIN_WEIGHT : 0;
+        }
+        if (!addRecord(builder, moves[i].key, moves[i].move, weight)) return false;
+    }
+    return true;
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, MSG_USAGE);
+        return 1;
+    }
+    int plies = argc > 3 ? atoi(argv[3]) : BOOKGEN_DEFAULT_PLIES;
+    long memory = argc > 4 ? atol(argv[4]) : BOOKGEN_DEFAULT_MEMORY;
+    if (plies < 1) plies = 1;
+    if (memory < 1) memory = 1;
+    FILE *pgn = fopen(argv[1], "r");
+    if (!pgn) {
+        fprintf(stderr, MSG_PGN_FAILED, argv[1]);
+        return 1;
+    }
+    Builder builder = { .capacity = 2, .size = 0, .runsCount = 0, .movesCount = 0 };
+    while (builder.capacity * 2 * sizeof(Record) <= (size_t)memory << 20) builder.capacity *= 2;
+    builder.records = calloc(builder.capacity, sizeof(Record));
+    GameMoves gameMoves = { .moves = malloc(plies * sizeof(GameMove)), .plies = plies };
+    ChessGame *game = ChessGame_Create();
+    ChessPgnReader *reader = ChessPgnReader_Create(pgn);
+    if (!builder.records || !gameMoves.moves || !game || !reader) {
+        fprintf(stderr, MSG_ALLOC_FAILED);
+        return 1;
+    }
+    ChessPgnHooks hooks = { .onMove = onGameMove, .context = &gameMoves };
+    ChessPgnGameInfo info;
+    unsigned long games = 0, cutShort = 0;
+    bool isFlushed = true;
+    while (isFlushed && ChessPgn_ReadGame(reader, game, &hooks, &info)) {
+        isFlushed = addGame(&builder, gameMoves.moves, gameMoves.count, info.result);
+        gameMoves.count = 0;
+        games++;
+        if (!info.isComplete) cutShort++; // e.g. castling, or a promotion
+    }
+    ChessPgnReader_Destroy(reader);
+    fclose(pgn);
+    ChessGame_Destroy(game);
+    free(gameMoves.moves);
+    bool isWritten = false;
+    if (!isFlushed || !flushRecords(&builder)) {
+        fprintf(stderr, MSG_RUN_FAILED);
+    } else {
+        FILE *book = fopen(argv[2], "wb");
+        isWritten = book && mergeRuns(&builder, book, true);
+        if (book && fclose(book) != 0) isWritten = false;
+        if (isWritten) {
+            printf(MSG_DONE, games, cutShort, builder.positions, builder.entries);
+        } else {
+            fprintf(stderr, MSG_BOOK_FAILED, argv[2]);
+        }
+    }
+    for (int i = 0; i < builder.runsCount; i++) fclose(builder.runs[i]);
+    free(builder.records);
+    return isWritten ? 0 : 1;
+}
@@ -0,0 +1,368 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime(), sysconf()
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ChessGame.h"
+#include "GameManager.h"
+
+#define EPD_LINE_SIZE           1024
+#define EPD_ID_SIZE             64
+#define EPD_MAX_MOVES           8 // per bm / am opcode
+#define EPD_MAX_THREADS         64
+#define EPD_DEFAULT_DEPTH       4
+
+#define MSG_USAGE               "usage: epd <suite file> [depth, 0 for none] [milliseconds per position, 0 for none, not both] [threads]\n"
+#define MSG_SUITE_FAILED        "ERROR: suite %s cannot be read\n"
+#define MSG_NO_PROBLEMS         "ERROR: suite %s has no positions with a bm or am opcode\n"
+#define MSG_ALLOC_FAILED        "ERROR: out of memory\n"
+#define MSG_LOADED              "loaded %zu positions, skipped %zu lines\n"
+#define MSG_UNSOLVED            "unsolved %s: played %s\n"
+#define MSG_SOLVED              "solved %zu of %zu\n"
+#define MSG_TIME_TO_SOLUTION    "average time to solution: %.3f s\n"
+#define MSG_NODES               "%lu nodes in %.3f s: %.0f nodes/s\n"
+
+
+/**
+ * A position of the suite, and the result of its search.
+ */
+typedef struct Problem {
+    char *record; // the EPD line, set up by each worker's own game
+    char id[EPD_ID_SIZE];
+    ChessMove bestMoves[EPD_MAX_MOVES];
+    int bestMovesCount;
+    ChessMove avoidMoves[EPD_MAX_MOVES];
+    int avoidMovesCount;
+    // written by the worker that searched it
+    long long start;
+    long long solveTime; // since the start, < 0 while the best move isn't a solution
+    ChessMove played;
+    bool isSolved;
+    unsigned long nodes; // of the search's completed depths
+} Problem;
+
+typedef struct Suite {
+    Problem *problems;
+    size_t size;
+    size_t capacity;
+} Suite;
+
+/**
+ * The positions left to search, shared by the worker threads.
+ */
+typedef struct Pool {
+    Suite *suite;
+    size_t next; // guarded by lock
+    pthread_mutex_t lock;
+    int depth;
+    long long limit; // milliseconds per position, 0 for none
+} Pool;
+
+/**
+ * The state of a worker's current search, its GameSearchHooks context.
+ */
+typedef struct Worker {
+    Problem *problem;
+    long long deadline; // 0 for none
+} Worker;
+
+/**
+ * Retrieve the time on a monotonic clock.
+ * @return  the time in milliseconds
+ */
+long long getTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (long long)time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+/**
+ * Skip a given number of whitespace-separated fields.
+ * @param   line        the line
+ * @param   fields      the number of fields to skip
+ * @return  the rest of the line, after the fields
+ */
+const char* skipFields(const char *line, int fields) {
+    for (int i = 0; i < fields; i++) {
+        while (isspace((unsigned char)*line)) line++;
+        while (*line && !isspace((unsigned char)*line)) line++;
+    }
+    return line;
+}
+
+/**
+ * Skip the two move clocks of a FEN record, if the record has them.
+ * @param   operations  the rest of the record, after its four fields
+ * @return  the rest of the record, after the clocks
+ */
+const char* skipOperationsClocks(const char *operations) {
+    const char *clocks = operations;
+    while (isspace((unsigned char)*clocks)) clocks++;
+    return isdigit((unsigned char)*clocks) ? skipFields(operations, 2) : operations;
+}
+
+/**
+ * Resolve the SAN moves of a bm or am opcode.
+ * @param   game        the problem's position
+ * @param   operands    the opcode's operands, e.g. "Nf3 Qd2"
+ * @param   moves       output parameter, EPD_MAX_MOVES long
+ * @param   count       output parameter for the number of moves
+ * @return  true        if all moves were resolved
+ *          false       otherwise, e.g. for castling or a promotion
+ */
+bool parseMoves(ChessGame *game, char *operands, ChessMove *moves, int *count) {
+    *count = 0;
+    for (char *san = strtok(operands, " \t"); san; san = strtok(NULL, " \t")) {
+        if (*count == EPD_MAX_MOVES) return false;
+        if (ChessGame_FromSAN(game, san, &moves[(*count)++]) != CHESS_SUCCESS) return false;
+    }
+    return *count > 0;
+}
+
+/**
+ * Parse the operations of an EPD record, e.g. bm Nf3; id "WAC.001";
+ * @param   game        the problem's position
+ * @param   operations  the operations, after the record's four fields
+ * @param   problem     output parameter for the id and the bm & am moves
+ * @return  true        if the record has a bm or an am opcode, all resolved
+ *          false       otherwise
+ */
+bool parseOperations(ChessGame *game, const char *operations, Problem *problem) {
+    char operation[EPD_LINE_SIZE];
+    while (*operations) {
+        int length = 0;
+        bool isQuoted = false;
+        for (; *operations && (*operations != ';' || isQuoted); operations++) {
+            if (*operations == '"') isQuoted = !isQuoted;
+            operation[length++] = *operations;
+        }
+        operation[length] = '\0';
+        if (*operations == ';') operations++;
+        char *operands = operation;
+        while (isspace((unsigned char)*operands)) operands++;
+        char *opcode = operands;
+        while (*operands && !isspace((unsigned char)*operands)) operands++;
+        if (*operands) *operands++ = '\0';
+        if (!strcmp(opcode, "bm")) {
+            if (!parseMoves(game, operands, problem->bestMoves, &problem->bestMovesCount)) return false;
+        } else if (!strcmp(opcode, "am")) {
+            if (!parseMoves(game, operands, problem->avoidMoves, &problem->avoidMovesCount)) return false;
+        } else if (!strcmp(opcode, "id")) {
+            char *id = strchr(operands, '"') ? strchr(operands, '"') + 1 : operands;
+            snprintf(problem->id, EPD_ID_SIZE, "%.*s", (int)strcspn(id, "\""), id);
+        }
+    }
+    return problem->bestMovesCount > 0 || problem->avoidMovesCount > 0;
+}
+
+/**
+ * Load the positions of an EPD suite file.
+ * @param   path        the suite file
+ * @param   suite       output parameter, its problems are appended
+ * @param   skipped     output parameter for the number of lines skipped
+ * @return  false       if the file can't be read or malloc failed
+ *          true        otherwise
+ */
+bool loadSuite(const char *path, Suite *suite, size_t *skipped) {
+    FILE *file = fopen(path, "r");
+    ChessGame *game = ChessGame_Create();
+    if (!file || !game) {
+        if (file) fclose(file);
+        if (game) ChessGame_Destroy(game);
+        return false;
+    }
+    char line[EPD_LINE_SIZE];
+    bool isLoaded = true;
+    size_t lines = 0;
+    *skipped = 0;
+    while (isLoaded && fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        Problem problem = { .bestMovesCount = 0, .avoidMovesCount = 0 };
+        snprintf(problem.id, EPD_ID_SIZE, "line %zu", ++lines); // unless it has an id
+        if (ChessGame_FromFEN(game, line) != CHESS_SUCCESS ||
+            !parseOperations(game, skipOperationsClocks(skipFields(line, 4)), &problem)) {
+            if (*line) (*skipped)++;
+            continue;
+        }
+        if (suite->size == suite->capacity) {
+            size_t capacity = suite->capacity ? suite->capacity * 2 : 64;
+            Problem *problems = realloc(suite->problems, capacity * sizeof(Problem));
+            if (!problems) {
+                isLoaded = false;
+                break;
+            }
+            suite->problems = problems;
+            suite->capacity = capacity;
+        }
+        problem.record = malloc(strlen(line) + 1);
+        if (!problem.record) {
+            isLoaded = false;
+            break;
+        }
+        strcpy(problem.record, line);
+        suite->problems[suite->size++] = problem;
+    }
+    fclose(file);
+    ChessGame_Destroy(game);
+    return isLoaded;
+}
+
+/**
+ * Check whether a given move solves a given problem.
+ * @param   problem     the problem
+ * @param   move        the move
+ * @return  true        if the move is one of the best moves (if any),
+ *                      and none of the moves to avoid
+ *          false       otherwise
+ */
+bool isSolution(const Problem *problem, ChessMove move) {
+    bool isBest = problem->bestMovesCount == 0;
+    for (int i = 0; i < problem->bestMovesCount; i++) {
+        const ChessMove *best = &problem->bestMoves[i];
+        isBest |= best->from.x == move.from.x && best->from.y == move.from.y &&
+                  best->to.x == move.to.x && best->to.y == move.to.y;
+    }
+    for (int i = 0; i < problem->avoidMovesCount; i++) {
+        const ChessMove *avoid = &problem->avoidMoves[i];
+        if (avoid->from.x == move.from.x && avoid->from.y == move.from.y &&
+            avoid->to.x == move.to.x && avoid->to.y == move.to.y) {
+            return false;
+        }
+    }
+    return isBest;
+}
+
+/**
+ * Check whether a worker's search is out of time.
+ * Polled by GameManager_Search() from the worker's thread.
+ * @param   context     the Worker
+ * @return  true        if the search should stop
+ *          false       otherwise
+ */
+bool isWorkerStopped(void *context) {
+    const Worker *worker = context;
+    return worker->deadline && getTime() >= worker->deadline;
+}
+
+/**
+ * Track when a worker's best move became a solution, and stayed one.
+ * Called by GameManager_Search() after each completed depth.
+ * @param   info        the search's result at the depth
+ * @param   context     the Worker
+ */
+void onWorkerDepth(const GameSearchInfo *info, void *context) {
+    Problem *problem = ((Worker *)context)->problem;
+    if (!isSolution(problem, info->bestMove)) {
+        problem->solveTime = -1;
+    } else if (problem->solveTime < 0) {
+        problem->solveTime = getTime() - problem->start;
+    }
+}
+
+/**
+ * Search the pool's positions, one at a time, until none are left.
+ * @param   argument    the Pool
+ * @return  NULL
+ */
+void* runWorker(void *argument) {
+    Pool *pool = argument;
+    ChessGame *game = ChessGame_Create();
+    if (!game) return NULL;
+    Worker worker;
+    GameSearchHooks hooks = {
+        .isStopped = isWorkerStopped,
+        .onDepth = onWorkerDepth,
+        .context = &worker,
+    };
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        size_t index = pool->next < pool->suite->size ? pool->next++ : pool->suite->size;
+        pthread_mutex_unlock(&pool->lock);
+        if (index == pool->suite->size) break;
+        Problem *problem = &pool->suite->problems[index];
+        ChessGame_FromFEN(game, problem->record);
+        worker.problem = problem;
+        problem->start = getTime();
+        problem->solveTime = -1;
+        worker.deadline = pool->limit ? problem->start + pool->limit : 0;
+        GameSearchInfo info;
+        bool isFound = GameManager_Search(game, pool->depth, &hooks, &info);
+        problem->played = info.bestMove;
+        problem->isSolved = isFound && isSolution(problem, info.bestMove);
+        problem->nodes = info.stats.nodes;
+    }
+    ChessGame_Destroy(game);
+    return NULL;
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, MSG_USAGE);
+        return 1;
+    }
+    int depth = argc > 2 ? atoi(argv[2]) : EPD_DEFAULT_DEPTH;
+    long long limit = argc > 3 ? atoll(argv[3]) : 0;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = argc > 4 ? atoi(argv[4]) : cores > 0 ? (int)cores : 1;
+    // a search unbounded by both depth & time never ends
+    if (depth < 0 || depth > GAME_SEARCH_MAX_DEPTH || limit < 0 || (!depth && !limit)) {
+        fprintf(stderr, MSG_USAGE);
+        return 1;
+    }
+    if (!depth) depth = GAME_SEARCH_MAX_DEPTH;
+    if (threads < 1) threads = 1;
+    if (threads > EPD_MAX_THREADS) threads = EPD_MAX_THREADS;
+    Suite suite = { .problems = NULL, .size = 0, .capacity = 0 };
+    size_t skipped;
+    if (!loadSuite(argv[1], &suite, &skipped)) {
+        fprintf(stderr, suite.size ? MSG_ALLOC_FAILED : MSG_SUITE_FAILED, argv[1]);
+        return 1;
+    }
+    printf(MSG_LOADED, suite.size, skipped);
+    if (!suite.size) {
+        fprintf(stderr, MSG_NO_PROBLEMS, argv[1]);
+        return 1;
+    }
+    Pool pool = { .suite = &suite, .next = 0, .depth = depth, .limit = limit };
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_t workers[EPD_MAX_THREADS];
+    bool isSpawned[EPD_MAX_THREADS];
+    long long start = getTime();
+    for (int i = 0; i < threads - 1; i++) { // and this thread
+        isSpawned[i] = pthread_create(&workers[i], NULL, runWorker, &pool) == 0;
+    }
+    runWorker(&pool);
+    for (int i = 0; i < threads - 1; i++) {
+        if (isSpawned[i]) pthread_join(workers[i], NULL);
+    }
+    double seconds = (getTime() - start) / 1000.0;
+    pthread_mutex_destroy(&pool.lock);
+    size_t solved = 0;
+    unsigned long nodes = 0;
+    double solveTime = 0;
+    ChessGame *game = ChessGame_Create();
+    for (size_t i = 0; i < suite.size; i++) {
+        Problem *problem = &suite.problems[i];
+        nodes += problem->nodes;
+        if (problem->isSolved) {
+            solved++;
+            solveTime += problem->solveTime / 1000.0;
+        } else if (game) {
+            char san[CHESS_SAN_SIZE] = "-";
+            ChessGame_FromFEN(game, problem->record);
+            ChessGame_ToSAN(game, problem->played, san);
+            printf(MSG_UNSOLVED, problem->id, san);
+        }
+        free(problem->record);
+    }
+    if (game) ChessGame_Destroy(game);
+    printf(MSG_SOLVED, solved, suite.size);
+    printf(MSG_TIME_TO_SOLUTION, solved ? solveTime / solved : 0);
+    printf(MSG_NODES, nodes, seconds, seconds > 0 ? nodes / seconds : 0);
+    free(suite.problems);
+    return 0;
+}
@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ChessGame.h"
+#include "ChessBitboard.h"
+#include "ChessTablebase.h"
+
+#define TBGEN_NO_CAPTURE        0 // capture outcomes: none, a draw, or a table value
+#define TBGEN_CAPTURE_DRAW      1
+
+#define MSG_USAGE               "usage: tbgen <tablebase file>\n"
+#define MSG_ALLOC_FAILED        "ERROR: out of memory\n"
+#define MSG_MISSING_TABLE       "ERROR: %s needs the %s table, which isn't generated before it\n"
+#define MSG_SAVE_FAILED         "ERROR: tablebase file %s cannot be written\n"
+#define MSG_TABLE               "%-5s %10u wins %10u draws %10u losses, longest mate %3d plies, %.1fs\n"
+
+
+// all 3-piece endings, and the 4-piece endings that come up in practice;
+// a table must be generated after the tables its captures lead to
+static const char *signatures[] = {
+    "KPK", "KNK", "KBK", "KRK", "KQK",
+    "KQQK", "KQRK", "KRRK", "KBBK", "KBNK",
+    "KQKR", "KQKB", "KQKN", "KRKB", "KRKN",
+};
+
+#define TABLES  ((int)(sizeof(signatures) / sizeof(signatures[0])))
+
+static const uint8_t *values[TABLES];
+
+/**
+ * The table being generated: its pieces, in signature order, and a
+ * decoded position.
+ */
+typedef struct Generator {
+    const char *signature;
+    int count;
+    ChessPiece pieces[CHESS_TABLEBASE_MAX_PIECES];
+    ChessColor colors[CHESS_TABLEBASE_MAX_PIECES];
+    uint32_t size;
+    uint8_t *values;
+    uint8_t *counts; // legal moves that stay in the table and aren't resolved yet
+    uint8_t *captures; // the best capture outcome, for the player to move
+} Generator;
+
+typedef struct Position {
+    int squares[CHESS_TABLEBASE_MAX_PIECES];
+    ChessColor turn;
+    ChessBitboard occupied;
+    ChessBitboard colorOccupied[2];
+} Position;
+
+/**
+ * Retrieve the ChessPiece of a signature letter.
+ * @param   letter      the letter
+ * @param   color       the piece's color
+ * @return  the piece
+ */
+ChessPiece getPiece(char letter, ChessColor color) {
+    bool isWhite = color == CHESS_PLAYER_COLOR_WHITE;
+    switch (letter) {
+        case 'K': return isWhite ? CHESS_PIECE_WHITE_KING : CHESS_PIECE_BLACK_KING;
+        case 'Q': return isWhite ? CHESS_PIECE_WHITE_QUEEN : CHESS_PIECE_BLACK_QUEEN;
+        case 'R': return isWhite ? CHESS_PIECE_WHITE_ROOK : CHESS_PIECE_BLACK_ROOK;
+        case 'B': return isWhite ? CHESS_PIECE_WHITE_BISHOP : CHESS_PIECE_BLACK_BISHOP;
+        case 'N': return isWhite ? CHESS_PIECE_WHITE_KNIGHT : CHESS_PIECE_BLACK_KNIGHT;
+        default: return isWhite ? CHESS_PIECE_WHITE_PAWN : CHESS_PIECE_BLACK_PAWN;
+    }
+}
+
+bool isPawnPiece(ChessPiece piece) {
+    return piece == CHESS_PIECE_WHITE_PAWN || piece == CHESS_PIECE_BLACK_PAWN;
+}
+
+/**
+ * Decode a given index of the generated table.
+ * @param   generator   the generated table
+ * @param   index       the index to decode
+ * @param   position    output parameter for the position
+ * @return  false       if two pieces share a square or a pawn is on its
+ *                      back rank, which can't happen
+ *          true        otherwise
+ */
+bool decodePosition(const Generator *generator, uint32_t index, Position *position) {
+    position->occupied = position->colorOccupied[0] = position->colorOccupied[1] = 0;
+    for (int i = generator->count - 1; i >= 0; i--) {
+        int square = index % CHESS_SQUARES;
+        index /= CHESS_SQUARES;
+        if (position->occupied & CHESS_BITBOARD(square)) return false;
+        int y = CHESS_SQUARE_Y(square);
+        if ((generator->pieces[i] == CHESS_PIECE_WHITE_PAWN && y == 0) ||
+            (generator->pieces[i] == CHESS_PIECE_BLACK_PAWN && y == CHESS_GRID - 1)) {
+            return false;
+        }
+        position->squares[i] = square;
+        position->occupied |= CHESS_BITBOARD(square);
+        position->colorOccupied[generator->colors[i]] |= CHESS_BITBOARD(square);
+    }
+    position->turn = index ? CHESS_PLAYER_COLOR_BLACK : CHESS_PLAYER_COLOR_WHITE;
+    return true;
+}
+
+uint32_t encodePosition(const Generator *generator, const Position *position) {
+    uint32_t index = position->turn == CHESS_PLAYER_COLOR_WHITE ? 0 : 1;
+    for (int i = 0; i < generator->count; i++) index = index * CHESS_SQUARES + position->squares[i];
+    return index;
+}
+
+/**
+ * Move a piece of a given position, updating its occupancy.
+ * @param   generator   the generated table
+ * @param   position    the position
+ * @param   piece       the index of the piece to move
+ * @param   to          the destination, which must be empty
+ */
+void movePiece(const Generator *generator, Position *position, int piece, int to) {
+    ChessBitboard change = CHESS_BITBOARD(position->squares[piece]) | CHESS_BITBOARD(to);
+    position->occupied ^= change;
+    position->colorOccupied[generator->colors[piece]] ^= change;
+    position->squares[piece] = to;
+}
+
+/**
+ * Check whether the king of a given player is attacked.
+ * @param   generator   the generated table
+ * @param   position    the position
+ * @param   color       the king's player
+ * @param   captured    the index of a captured piece to ignore, or -1
+ * @return  true        if the king is attacked
+ *          false       otherwise
+ */
+bool isKingAttacked(const Generator *generator, const Position *position, ChessColor color,
+                    int captured) {
+    int king = -1;
+    for (int i = 0; i < generator->count && king < 0; i++) {
+        bool isKing = generator->pieces[i] == CHESS_PIECE_WHITE_KING ||
+                      generator->pieces[i] == CHESS_PIECE_BLACK_KING;
+        if (isKing && generator->colors[i] == color) king = i;
+    }
+    ChessBitboard target = CHESS_BITBOARD(position->squares[king]);
+    for (int i = 0; i < generator->count; i++) {
+        if (i == captured || generator->colors[i] == color) continue;
+        ChessBitboard attacks = ChessBitboard_GetAttacks(generator->pieces[i],
+                                                         position->squares[i],
+                                                         position->occupied);
+        if (attacks & target) return true;
+    }
+    return false;
+}
+
+/**
+ * Find the generated values of a given table.
+ * @param   signature   the table's signature
+ * @return  NULL        if the table isn't generated yet
+ *          its values otherwise
+ */
+const uint8_t* findTable(const char *signature) {
+    for (int i = 0; i < TABLES; i++) {
+        if (strcmp(signatures[i], signature) == 0) return values[i];
+    }
+    return NULL;
+}
+
+/**
+ * Look up the outcome of a capture, in the table of the remaining pieces.
+ * @param   generator   the generated table
+ * @param   position    the position after the capture, the captured piece
+ *                      still listed
+ * @param   captured    the index of the captured piece
+ * @param   outcome     output parameter: TBGEN_CAPTURE_DRAW, or the value
+ *                      of the capture for the player who made it
+ * @return  false       if the remaining pieces' table isn't generated
+ *          true        otherwise
+ */
+bool getCaptureOutcome(const Generator *generator, const Position *position, int captured,
+                       uint8_t *outcome) {
+    ChessTablebasePosition child = { .count = 0, .turn = position->turn };
+    for (int i = 0; i < generator->count; i++) {
+        if (i == captured) continue;
+        child.pieces[child.count] = generator->pieces[i];
+        child.squares[child.count++] = position->squares[i];
+    }
+    *outcome = TBGEN_CAPTURE_DRAW;
+    if (child.count == 2) return true; // kings only
+    char signature[CHESS_TABLEBASE_SIGNATURE_SIZE];
+    uint32_t index;
+    ChessTablebase_GetKey(&child, signature, &index);
+    const uint8_t *table = findTable(signature);
+    if (!table) {
+        fprintf(stderr, MSG_MISSING_TABLE, generator->signature, signature);
+        return false;
+    }
+    // one more ply to mate, from the other player's point of view
+    if (table[index] != CHESS_TABLEBASE_DRAW) *outcome = table[index] + 1;
+    return true;
+}
+
+/**
+ * Rank a capture outcome for the player making it: quick wins first,
+ * then draws, then slow losses.
+ * @param   outcome     the capture outcome
+ * @return  the outcome's rank, higher is better
+ */
+int rankOutcome(uint8_t outcome) {
+    if (outcome == TBGEN_NO_CAPTURE) return -1000;
+    if (outcome == TBGEN_CAPTURE_DRAW) return 0;
+    return outcome % 2 ? -500 + outcome : 500 - outcome;
+}
+
+/**
+ * Generate the legal moves of a given position's player to move, counting
+ * the ones that stay in the table and keeping the best capture outcome.
+ * @param   generator   the generated table
+ * @param   position    the position
+ * @param   count       output parameter for the number of in-table moves
+ * @param   capture     output parameter for the best capture outcome
+ * @return  false       if a capture leads to a missing table
+ *          true        otherwise
+ */
+bool generateMoves(const Generator *generator, const Position *position, int *count,
+                   uint8_t *capture) {
+    ChessColor turn = position->turn;
+    *count = 0;
+    *capture = TBGEN_NO_CAPTURE;
+    for (int i = 0; i < generator->count; i++) {
+        if (generator->colors[i] != turn) continue;
+        ChessPiece piece = generator->pieces[i];
+        int from = position->squares[i];
+        ChessBitboard attacks = ChessBitboard_GetAttacks(piece, from, position->occupied);
+        ChessBitboard quiets = attacks & ~position->occupied;
+        if (isPawnPiece(piece)) { // like ChessGame, a double step may jump over a piece
+            int step = turn == CHESS_PLAYER_COLOR_WHITE ? CHESS_GRID : -CHESS_GRID;
+            int y = CHESS_SQUARE_Y(from), startY = turn == CHESS_PLAYER_COLOR_WHITE ? 1 : 6;
+            bool isLastRank = y == (turn == CHESS_PLAYER_COLOR_WHITE ? CHESS_GRID - 1 : 0);
+            quiets = 0;
+            if (!isLastRank) quiets |= CHESS_BITBOARD(from + step) & ~position->occupied;
+            if (y == startY) quiets |= CHESS_BITBOARD(from + 2 * step) & ~position->occupied;
+        }
+        while (quiets) {
+            Position child = *position;
+            movePiece(generator, &child, i, ChessBitboard_PopSquare(&quiets));
+            if (!isKingAttacked(generator, &child, turn, -1)) (*count)++;
+        }
+        ChessBitboard targets = attacks & position->colorOccupied[!turn];
+        while (targets) {
+            int to = ChessBitboard_PopSquare(&targets);
+            int captured = 0;
+            while (position->squares[captured] != to) captured++;
+            Position child = *position;
+            child.occupied &= ~CHESS_BITBOARD(to);
+            child.colorOccupied[!turn] &= ~CHESS_BITBOARD(to);
+            movePiece(generator, &child, i, to);
+            child.turn = !turn;
+            if (isKingAttacked(generator, &child, turn, captured)) continue;
+            uint8_t outcome;
+            if (!getCaptureOutcome(generator, &child, captured, &outcome)) return false;
+            if (rankOutcome(outcome) > rankOutcome(*capture)) *capture = outcome;
+        }
+    }
+    return true;
+}
+
+/**
+ * Find the positions that lead to a given position by a move of the player
+ * who isn't to move in it, and update them with its resolved value.
+ * @param   generator   the generated table
+ * @param   position    the resolved position
+ * @param   plies       the position's plies to mate
+ * @param   last        the highest value set so far, updated in place
+ */
+void updatePredecessors(Generator *generator, const Position *position, int plies, int *last) {
+    ChessColor mover = !position->turn;
+    bool isLoss = plies % 2 == 0; // for the player to move
+    for (int i = 0; i < generator->count; i++) {
+        if (generator->colors[i] != mover) continue;
+        ChessPiece piece = generator->pieces[i];
+        int to = position->squares[i];
+        ChessBitboard froms = ChessBitboard_GetAttacks(piece, to, position->occupied) &
+                              ~position->occupied;
+        if (isPawnPiece(piece)) {
+            int step = mover == CHESS_PLAYER_COLOR_WHITE ? CHESS_GRID : -CHESS_GRID;
+            int y = CHESS_SQUARE_Y(to);
+            int firstY = mover == CHESS_PLAYER_COLOR_WHITE ? 2 : CHESS_GRID - 3;
+            int doubleY = mover == CHESS_PLAYER_COLOR_WHITE ? 3 : CHESS_GRID - 4;
+            bool isForward = mover == CHESS_PLAYER_COLOR_WHITE ? y >= firstY : y <= firstY;
+            froms = 0;
+            if (isForward) froms |= CHESS_BITBOARD(to - step) & ~position->occupied;
+            if (y == doubleY) froms |= CHESS_BITBOARD(to - 2 * step) & ~position->occupied;
+        }
+        while (froms) {
+            Position parent = *position;
+            movePiece(generator, &parent, i, ChessBitboard_PopSquare(&froms));
+            parent.turn = mover;
+            if (isKingAttacked(generator, &parent, position->turn, -1)) continue; // illegal
+            uint32_t index = encodePosition(generator, &parent);
+            uint8_t value = generator->values[index];
+            if (isLoss) { // the parent wins by moving here, unless it already wins faster
+                if (plies + 1 > CHESS_TABLEBASE_MAX_PLIES) continue;
+                if (value == CHESS_TABLEBASE_DRAW || (value % 2 == 0 && value > plies + 2)) {
+                    generator->values[index] = plies + 2;
+                    if (plies + 2 > *last) *last = plies + 2;
+                }
+                continue;
+            }
+            if (value != CHESS_TABLEBASE_DRAW || --generator->counts[index]) continue;
+            // every move of the parent loses, it loses as slowly as it can
+            uint8_t capture = generator->captures[index];
+            if (capture == TBGEN_CAPTURE_DRAW) continue;
+            int parentPlies = plies + 1;
+            if (capture != TBGEN_NO_CAPTURE && capture - 1 > parentPlies) parentPlies = capture - 1;
+            if (parentPlies > CHESS_TABLEBASE_MAX_PLIES) continue;
+            generator->values[index] = parentPlies + 1;
+            if (parentPlies + 1 > *last) *last = parentPlies + 1;
+        }
+    }
+}
+
+/**
+ * Generate a table by retrograde analysis: mates are found first, then the
+ * positions one ply before them, and so on, until nothing changes.
+ * Positions that are never resolved are draws.
+ * @param   signature   the table's signature
+ * @return  NULL        if malloc failed or a capture leads to a missing table,
+ *                      which is reported
+ *          the table's values otherwise
+ */
+uint8_t* generateTable(const char *signature) {
+    Generator generator = { .signature = signature, .count = strlen(signature) };
+    ChessColor color = CHESS_PLAYER_COLOR_WHITE;
+    for (int i = 0; i < generator.count; i++) {
+        if (i > 0 && signature[i] == 'K') color = CHESS_PLAYER_COLOR_BLACK;
+        generator.colors[i] = color;
+        generator.pieces[i] = getPiece(signature[i], color);
+    }
+    generator.size = ChessTablebase_GetTableSize(generator.count);
+    generator.values = calloc(generator.size, 1);
+    generator.counts = calloc(generator.size, 1);
+    generator.captures = calloc(generator.size, 1);
+    bool isGenerated = generator.values && generator.counts && generator.captures;
+    if (!isGenerated) fprintf(stderr, MSG_ALLOC_FAILED);
+    int last = 0;
+    // mates, stalemates and the positions whose best move is a capture
+    for (uint32_t index = 0; isGenerated && index < generator.size; index++) {
+        Position position;
+        if (!decodePosition(&generator, index, &position)) continue;
+        if (isKingAttacked(&generator, &position, !position.turn, -1)) continue;
+        int count;
+        uint8_t capture;
+        if (!generateMoves(&generator, &position, &count, &capture)) {
+            isGenerated = false;
+            break;
+        }
+        generator.counts[index] = count;
+        generator.captures[index] = capture;
+        uint8_t value = CHESS_TABLEBASE_DRAW;
+        if (!count && capture == TBGEN_NO_CAPTURE) { // no moves at all
+            if (isKingAttacked(&generator, &position, position.turn, -1)) value = 1;
+        } else if (capture != TBGEN_NO_CAPTURE && capture != TBGEN_CAPTURE_DRAW &&
+                   (capture % 2 == 0 || !count)) { // a winning capture, or only losing ones
+            value = capture;
+        }
+        generator.values[index] = value;
+        if (value > last) last = value;
+    }
+    for (int plies = 0; isGenerated && plies < last; plies++) {
+        for (uint32_t index = 0; index < generator.size; index++) {
+            if (generator.values[index] != plies + 1) continue;
+            Position position;
+            decodePosition(&generator, index, &position);
+            updatePredecessors(&generator, &position, plies, &last);
+        }
+    }
+    // mark the duplicates ChessTablebase_GetKey() never returns, so they compress away
+    for (uint32_t index = 0; isGenerated && index < generator.size; index++) {
+        Position position;
+        ChessTablebasePosition key = { .count = generator.count };
+        char keySignature[CHESS_TABLEBASE_SIGNATURE_SIZE];
+        uint32_t keyIndex = 0;
+        if (decodePosition(&generator, index, &position) &&
+            !isKingAttacked(&generator, &position, !position.turn, -1)) {
+            key.turn = position.turn;
+            memcpy(key.pieces, generator.pieces, sizeof(key.pieces));
+            memcpy(key.squares, position.squares, sizeof(key.squares));
+            ChessTablebase_GetKey(&key, keySignature, &keyIndex);
+            if (keyIndex == index && strcmp(keySignature, signature) == 0) continue;
+        }
+        generator.values[index] = CHESS_TABLEBASE_UNUSED;
+    }
+    free(generator.counts);
+    free(generator.captures);
+    if (!isGenerated) {
+        free(generator.values);
+        return NULL;
+    }
+    return generator.values;
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, MSG_USAGE);
+        return 1;
+    }
+    int status = 0;
+    for (int i = 0; i < TABLES && !status; i++) {
+        clock_t start = clock();
+        uint8_t *table = generateTable(signatures[i]);
+        if (!table) {
+            status = 1;
+            break;
+        }
+        values[i] = table;
+        unsigned int wins = 0, draws = 0, losses = 0;
+        int longest = 0;
+        for (uint32_t j = 0; j < ChessTablebase_GetTableSize(strlen(signatures[i])); j++) {
+            if (table[j] == CHESS_TABLEBASE_UNUSED) continue;
+            ChessTablebaseResult result;
+            ChessTablebase_DecodeValue(table[j], &result);
+            if (result.wdl > 0) wins++;
+            else if (result.wdl < 0) losses++;
+            else draws++;
+            if (result.plies > longest) longest = result.plies;
+        }
+        printf(MSG_TABLE, signatures[i], wins, draws, losses, longest,
+               (double)(clock() - start) / CLOCKS_PER_SEC);
+        fflush(stdout);
+    }
+    if (!status && !ChessTablebase_Save(argv[1], signatures, values, TABLES)) {
+        fprintf(stderr, MSG_SAVE_FAILED, argv[1]);
+        status = 1;
+    }
+    for (int i = 0; i < TABLES; i++) free((uint8_t *)values[i]);
+    return status;
+}
@@ -0,0 +1,453 @@
+#define _POSIX_C_SOURCE 200809L // sysconf()
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ChessGame.h"
+#include "ChessEval.h"
+#include "ChessBitboard.h"
+
+#define TUNE_LINE_SIZE          512
+#define TUNE_MAX_THREADS        64
+#define TUNE_DEFAULT_EPOCHS     200
+#define TUNE_QUIESCENCE_DEPTH   4 // captures
+#define TUNE_MAX_CAPTURES       64
+#define TUNE_LEARNING_RATE      1.0
+#define TUNE_BETA1              0.9
+#define TUNE_BETA2              0.999
+#define TUNE_EPSILON            1e-8
+#define TUNE_K_ROUNDS           3
+#define TUNE_K_STEPS            10
+
+#define MSG_USAGE               "usage: tune <dataset> <weights output> [epochs] [threads]\n"
+#define MSG_DATASET_FAILED      "ERROR: dataset %s cannot be read\n"
+#define MSG_NO_POSITIONS        "ERROR: dataset %s has no labelled positions\n"
+#define MSG_WEIGHTS_FAILED      "ERROR: weights file %s cannot be written\n"
+#define MSG_ALLOC_FAILED        "ERROR: out of memory\n"
+#define MSG_LOADED              "loaded %zu positions, skipped %zu lines\n"
+#define MSG_K                   "K = %.3f, error = %.6f\n"
+#define MSG_EPOCH               "epoch %d: error = %.6f\n"
+
+
+/**
+ * A labelled position packed into 34 bytes, so large datasets fit in memory.
+ */
+typedef struct Position {
+    uint8_t squares[CHESS_SQUARES / 2]; // two 4-bit piece codes per byte
+    uint8_t turn;
+    uint8_t result; // from white's point of view: 0 - loss, 1 - draw, 2 - win
+} Position;
+
+typedef struct Dataset {
+    Position *positions;
+    size_t size;
+    size_t capacity;
+} Dataset;
+
+/**
+ * A slice of the dataset processed by a worker thread, with everything
+ * the worker writes kept private until it's joined.
+ */
+typedef struct Job {
+    Dataset *dataset;
+    size_t begin;
+    size_t end;
+    const double *params; // NULL for the quiescence pass
+    double k;
+    bool isGradient;
+    double error;
+    double gradient[CHESS_EVAL_WEIGHTS];
+    ChessEvalTrace trace;
+} Job;
+
+typedef struct Capture {
+    ChessMove move;
+    int order;
+} Capture;
+
+static const ChessPiece pieceCodes[] = {
+    CHESS_PIECE_NONE,
+    CHESS_PIECE_WHITE_PAWN, CHESS_PIECE_WHITE_ROOK, CHESS_PIECE_WHITE_KNIGHT,
+    CHESS_PIECE_WHITE_BISHOP, CHESS_PIECE_WHITE_QUEEN, CHESS_PIECE_WHITE_KING,
+    CHESS_PIECE_BLACK_PAWN, CHESS_PIECE_BLACK_ROOK, CHESS_PIECE_BLACK_KNIGHT,
+    CHESS_PIECE_BLACK_BISHOP, CHESS_PIECE_BLACK_QUEEN, CHESS_PIECE_BLACK_KING,
+};
+
+static const struct {
+    const char *token;
+    uint8_t result;
+} resultTokens[] = {
+    { "\"1-0\"", 2 }, { "\"0-1\"", 0 }, { "\"1/2-1/2\"", 1 },
+    { "[1.0]", 2 }, { "[0.0]", 0 }, { "[0.5]", 1 },
+    { "[1]", 2 }, { "[0]", 0 },
+};
+
+/**
+ * Pack the board & turn of a given game.
+ * @param   game        the game to pack
+ * @param   position    output parameter, its result isn't changed
+ */
+void packPosition(const ChessGame *game, Position *position) {
+    memset(position->squares, 0, sizeof(position->squares));
+    for (int square = 0; square < CHESS_SQUARES; square++) {
+        ChessPiece piece = CHESS_BOARD_AT(game, CHESS_SQUARE_X(square), CHESS_SQUARE_Y(square));
+        uint8_t code = 0;
+        while (pieceCodes[code] != piece) code++;
+        position->squares[square / 2] |= code << (square % 2 * 4);
+    }
+    position->turn = game->turn;
+}
+
+/**
+ * Set up a given game from a packed position.
+ * @param   game        the game to set up
+ * @param   position    the position to unpack
+ */
+void unpackPosition(ChessGame *game, const Position *position) {
+    for (int square = 0; square < CHESS_SQUARES; square++) {
+        uint8_t code = position->squares[square / 2] >> (square % 2 * 4) & 0xF;
+        CHESS_BOARD_AT(game, CHESS_SQUARE_X(square), CHESS_SQUARE_Y(square)) = pieceCodes[code];
+    }
+    game->turn = position->turn;
+    game->halfmoveClock = 0;
+    ChessGame_RefreshState(game);
+}
+
+/**
+ * Find the game result label of a dataset line.
+ * @param   line        the line, an EPD or FEN record followed by a label
+ * @param   result      output parameter for the result
+ * @return  true        if the line has a label
+ *          false       otherwise
+ */
+bool parseResult(const char *line, uint8_t *result) {
+    for (size_t i = 0; i < sizeof(resultTokens) / sizeof(resultTokens[0]); i++) {
+        if (!strstr(line, resultTokens[i].token)) continue;
+        *result = resultTokens[i].result;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Read the labelled positions of a given dataset file, one per line.
+ * @param   path        the dataset path
+ * @param   dataset     output parameter for the positions
+ * @param   skipped     output parameter for the number of unusable lines
+ * @return  false       if the file can't be read or memory ran out
+ *          true        otherwise
+ */
+bool loadDataset(const char *path, Dataset *dataset, size_t *skipped) {
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+    ChessGame *game = ChessGame_Create();
+    char line[TUNE_LINE_SIZE];
+    bool isLoaded = game != NULL;
+    *skipped = 0;
+    while (isLoaded && fgets(line, sizeof(line), file)) {
+        Position position;
+        if (!parseResult(line, &position.result) ||
+            ChessGame_FromFEN(game, line) != CHESS_SUCCESS) {
+            (*skipped)++;
+            continue;
+        }
+        packPosition(game, &position);
+        if (dataset->size == dataset->capacity) {
+            size_t capacity = dataset->capacity ? dataset->capacity * 2 : 1024;
+            Position *positions = realloc(dataset->positions, capacity * sizeof(Position));
+            if (!positions) {
+                isLoaded = false;
+                break;
+            }
+            dataset->positions = positions;
+            dataset->capacity = capacity;
+        }
+        dataset->positions[dataset->size++] = position;
+    }
+    ChessGame_Destroy(game);
+    fclose(file);
+    return isLoaded;
+}
+
+/**
+ * Collect the legal captures of the player to move in a given game, most
+ * valuable victim first, then least valuable attacker.
+ * @param   game        the game to collect the captures of
+ * @param   captures    output parameter, at least TUNE_MAX_CAPTURES long
+ * @return  the number of captures
+ */
+int getCaptures(ChessGame *game, Capture *captures) {
+    ChessBitboard occupied = game->occupancy[CHESS_PLAYER_COLOR_BLACK] |
+                             game->occupancy[CHESS_PLAYER_COLOR_WHITE];
+    ChessBitboard pieces = game->occupancy[game->turn];
+    int count = 0;
+    while (pieces && count < TUNE_MAX_CAPTURES) {
+        int from = ChessBitboard_PopSquare(&pieces);
+        ChessPiece piece = CHESS_BOARD_AT(game, CHESS_SQUARE_X(from), CHESS_SQUARE_Y(from));
+        ChessBitboard targets = piece == CHESS_PIECE_WHITE_PAWN || piece == CHESS_PIECE_BLACK_PAWN
+            ? ChessBitboard_GetPawnsAttacks(CHESS_BITBOARD(from), game->turn)
+            : ChessBitboard_GetAttacks(piece, from, occupied);
+        targets &= game->occupancy[!game->turn];
+        while (targets && count < TUNE_MAX_CAPTURES) {
+            int to = ChessBitboard_PopSquare(&targets);
+            ChessPiece victim = CHESS_BOARD_AT(game, CHESS_SQUARE_X(to), CHESS_SQUARE_Y(to));
+            ChessMove move = {
+                .from = { .x = CHESS_SQUARE_X(from), .y = CHESS_SQUARE_Y(from) },
+                .to = { .x = CHESS_SQUARE_X(to), .y = CHESS_SQUARE_Y(to) },
+            };
+            int order = abs(ChessEval_GetPieceScore(victim)) * 16 -
+                        abs(ChessEval_GetPieceScore(piece)) / 100;
+            int i = count++;
+            for (; i > 0 && captures[i - 1].order < order; i--) captures[i] = captures[i - 1];
+            captures[i] = (Capture){ .move = move, .order = order };
+        }
+    }
+    return count;
+}
+
+/**
+ * Run a captures-only search on a given game and find the quiet position
+ * at the end of its principal variation, so the tuner fits the static
+ * evaluation to positions it can actually judge.
+ * @param   game        the game to search, restored when done
+ * @param   alpha       the window's lower bound, for the player to move
+ * @param   beta        the window's upper bound, for the player to move
+ * @param   depth       the remaining number of captures
+ * @param   trace       scratch space for the evaluations
+ * @param   leaf        output parameter for the quiet position
+ * @return  the position's score, for the player to move
+ */
+int quiescence(ChessGame *game, int alpha, int beta, int depth,
+               ChessEvalTrace *trace, Position *leaf) {
+    int score = ChessEval_Trace(game, trace);
+    if (game->turn == CHESS_PLAYER_COLOR_BLACK) score = -score;
+    packPosition(game, leaf);
+    if (score >= beta || !depth) return score;
+    if (score > alpha) alpha = score;
+    Capture captures[TUNE_MAX_CAPTURES];
+    int count = getCaptures(game, captures);
+    for (int i = 0; i < count && alpha < beta; i++) {
+        if (ChessGame_DoMove(game, captures[i].move) != CHESS_SUCCESS) continue;
+        Position childLeaf;
+        int childScore = -quiescence(game, -beta, -alpha, depth - 1, trace, &childLeaf);
+        ChessMove move;
+        ChessGame_UndoMove(game, &move);
+        if (childScore > score) score = childScore;
+        if (childScore > alpha) {
+            alpha = childScore;
+            memcpy(leaf->squares, childLeaf.squares, sizeof(leaf->squares));
+            leaf->turn = childLeaf.turn;
+        }
+    }
+    return score;
+}
+
+/**
+ * Calculate the linear evaluation of a traced position with given weights.
+ * @param   trace       the position's terms
+ * @param   params      the weights, CHESS_EVAL_WEIGHTS long
+ * @return  the score, from white's point of view
+ */
+double evaluateTrace(const ChessEvalTrace *trace, const double *params) {
+    int phase = trace->phase < 0 ? 0 :
+                trace->phase > CHESS_EVAL_PHASE_MAX ? CHESS_EVAL_PHASE_MAX : trace->phase;
+    double midgame = 0, endgame = 0;
+    for (int i = 0; i < trace->size; i++) {
+        const ChessEvalTerm *term = &trace->terms[i];
+        if (term->isEndgame) {
+            endgame += params[term->index] * term->count;
+        } else {
+            midgame += params[term->index] * term->count;
+        }
+    }
+    return (midgame * phase + endgame * (CHESS_EVAL_PHASE_MAX - phase)) / CHESS_EVAL_PHASE_MAX;
+}
+
+/**
+ * Map a score to an expected game result, in [0, 1].
+ * @param   score       the score, in centipawns
+ * @param   k           the scaling constant
+ * @return  the expected result
+ */
+double sigmoid(double score, double k) {
+    return 1.0 / (1.0 + pow(10.0, -k * score / 400.0));
+}
+
+/**
+ * Process a slice of the dataset: either replace its positions with their
+ * quiescence search leaves, or sum their squared errors (and their
+ * gradient) under the job's weights.
+ * @param   arg         the Job to run
+ * @return  NULL
+ */
+void* runJob(void *arg) {
+    Job *job = arg;
+    ChessGame *game = ChessGame_Create();
+    if (!game) return NULL;
+    job->error = 0;
+    memset(job->gradient, 0, sizeof(job->gradient));
+    for (size_t i = job->begin; i < job->end; i++) {
+        Position *position = &job->dataset->positions[i];
+        unpackPosition(game, position);
+        if (!job->params) {
+            quiescence(game, -CHESS_EVAL_CHECKMATE_SCORE, CHESS_EVAL_CHECKMATE_SCORE,
+                       TUNE_QUIESCENCE_DEPTH, &job->trace, position);
+            continue;
+        }
+        ChessEval_Trace(game, &job->trace);
+        double expected = sigmoid(evaluateTrace(&job->trace, job->params), job->k);
+        double difference = position->result / 2.0 - expected;
+        job->error += difference * difference;
+        if (!job->isGradient) continue;
+        // d(error) / d(score), the per-weight coefficients are the term counts tapered by phase
+        double slope = -2 * difference * expected * (1 - expected) * job->k * log(10.0) / 400.0;
+        int phase = job->trace.phase < 0 ? 0 :
+                    job->trace.phase > CHESS_EVAL_PHASE_MAX ? CHESS_EVAL_PHASE_MAX : job->trace.phase;
+        for (int j = 0; j < job->trace.size; j++) {
+            const ChessEvalTerm *term = &job->trace.terms[j];
+            int taper = term->isEndgame ? CHESS_EVAL_PHASE_MAX - phase : phase;
+            job->gradient[term->index] += slope * term->count * taper / CHESS_EVAL_PHASE_MAX;
+        }
+    }
+    ChessGame_Destroy(game);
+    return NULL;
+}
+
+/**
+ * Run a pass over the whole dataset, split evenly between worker threads.
+ * @param   jobs        the workers' jobs, their output is left in place
+ * @param   threads     the number of workers
+ * @param   dataset     the dataset
+ * @param   params      the weights, or NULL for the quiescence pass
+ * @param   k           the sigmoid scaling constant
+ * @param   isGradient  whether to compute the gradient
+ * @return  the mean squared error, 0 for the quiescence pass
+ */
+double runPass(Job *jobs, int threads, Dataset *dataset, const double *params,
+               double k, bool isGradient) {
+    pthread_t workers[TUNE_MAX_THREADS];
+    bool isSpawned[TUNE_MAX_THREADS];
+    double error = 0;
+    for (int i = 0; i < threads; i++) {
+        jobs[i].dataset = dataset;
+        jobs[i].begin = dataset->size * i / threads;
+        jobs[i].end = dataset->size * (i + 1) / threads;
+        jobs[i].params = params;
+        jobs[i].k = k;
+        jobs[i].isGradient = isGradient;
+        isSpawned[i] = pthread_create(&workers[i], NULL, runJob, &jobs[i]) == 0;
+        if (!isSpawned[i]) runJob(&jobs[i]); // no thread to spare, run it inline
+    }
+    for (int i = 0; i < threads; i++) {
+        if (isSpawned[i]) pthread_join(workers[i], NULL);
+        error += jobs[i].error;
+    }
+    return error / dataset->size;
+}
+
+/**
+ * Find the sigmoid scaling constant that best fits the initial weights,
+ * by narrowing a grid search.
+ * @return  the scaling constant
+ */
+double fitK(Job *jobs, int threads, Dataset *dataset, const double *params) {
+    double best = 1.0, step = 0.5;
+    double bestError = runPass(jobs, threads, dataset, params, best, false);
+    for (int round = 0; round < TUNE_K_ROUNDS; round++, step /= TUNE_K_STEPS / 2) {
+        double center = best;
+        for (int i = -TUNE_K_STEPS / 2; i <= TUNE_K_STEPS / 2; i++) {
+            double k = center + i * step;
+            if (k <= 0 || i == 0) continue;
+            double error = runPass(jobs, threads, dataset, params, k, false);
+            if (error < bestError) {
+                bestError = error;
+                best = k;
+            }
+        }
+    }
+    printf(MSG_K, best, bestError);
+    return best;
+}
+
+/**
+ * Round given weights into the engine and save them.
+ * @param   params      the weights, CHESS_EVAL_WEIGHTS long
+ * @param   path        the weights file path
+ * @return  false       if the file can't be written
+ *          true        otherwise
+ */
+bool saveParams(const double *params, const char *path) {
+    for (int i = 0; i < CHESS_EVAL_WEIGHTS; i++) {
+        ChessEval_SetWeight(i, (int)lround(params[i]));
+    }
+    return ChessEval_SaveWeights(path);
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, MSG_USAGE);
+        return 1;
+    }
+    int epochs = argc > 3 ? atoi(argv[3]) : TUNE_DEFAULT_EPOCHS;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = argc > 4 ? atoi(argv[4]) : cores > 0 ? (int)cores : 1;
+    if (threads < 1) threads = 1;
+    if (threads > TUNE_MAX_THREADS) threads = TUNE_MAX_THREADS;
+    Dataset dataset = { .positions = NULL, .size = 0, .capacity = 0 };
+    size_t skipped;
+    if (!loadDataset(argv[1], &dataset, &skipped)) {
+        if (dataset.size) {
+            fprintf(stderr, MSG_ALLOC_FAILED);
+        } else {
+            fprintf(stderr, MSG_DATASET_FAILED, argv[1]);
+        }
+        free(dataset.positions);
+        return 1;
+    }
+    printf(MSG_LOADED, dataset.size, skipped);
+    if (!dataset.size) {
+        fprintf(stderr, MSG_NO_POSITIONS, argv[1]);
+        return 1;
+    }
+    Job *jobs = malloc(threads * sizeof(Job));
+    double *params = malloc(3 * CHESS_EVAL_WEIGHTS * sizeof(double));
+    if (!jobs || !params) {
+        fprintf(stderr, MSG_ALLOC_FAILED);
+        return 1;
+    }
+    double *moments = params + CHESS_EVAL_WEIGHTS, *velocities = moments + CHESS_EVAL_WEIGHTS;
+    for (int i = 0; i < CHESS_EVAL_WEIGHTS; i++) {
+        params[i] = ChessEval_GetWeight(i);
+        moments[i] = velocities[i] = 0;
+    }
+    runPass(jobs, threads, &dataset, NULL, 0, false);
+    double k = fitK(jobs, threads, &dataset, params);
+    for (int epoch = 1; epoch <= epochs; epoch++) { // Adam, on the full-batch gradient
+        double error = runPass(jobs, threads, &dataset, params, k, true);
+        for (int i = 0; i < CHESS_EVAL_WEIGHTS; i++) {
+            double gradient = 0;
+            for (int j = 0; j < threads; j++) gradient += jobs[j].gradient[i];
+            gradient /= dataset.size;
+            moments[i] = TUNE_BETA1 * moments[i] + (1 - TUNE_BETA1) * gradient;
+            velocities[i] = TUNE_BETA2 * velocities[i] + (1 - TUNE_BETA2) * gradient * gradient;
+            double moment = moments[i] / (1 - pow(TUNE_BETA1, epoch));
+            double velocity = velocities[i] / (1 - pow(TUNE_BETA2, epoch));
+            params[i] -= TUNE_LEARNING_RATE * moment / (sqrt(velocity) + TUNE_EPSILON);
+        }
+        printf(MSG_EPOCH, epoch, error);
+        fflush(stdout);
+    }
+    int status = 0;
+    if (!saveParams(params, argv[2])) {
+        fprintf(stderr, MSG_WEIGHTS_FAILED, argv[2]);
+        status = 1;
+    }
+    free(params);
+    free(jobs);
+    free(dataset.positions);
+    return status;
+}